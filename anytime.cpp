@@ -0,0 +1,375 @@
+#include "anytime.hpp"
+#include "search.hpp"
+#include "space.hpp"
+#include "report.hpp"
+#include "cmdline.hpp"
+#include "filter.hpp"
+#include "metric.hpp"
+#include "ship.hpp"
+#include "trace.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace hf::design {
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+using seconds = std::chrono::duration<double>;
+
+constexpr unsigned epoch_steps = 256;       // between trading candidates
+constexpr unsigned cycle_steps = 4096;      // cooling from t_hot to t_cold, then again
+constexpr double t_hot = .05, t_cold = .0005; // relative worsening taken with p = 1/e
+constexpr std::size_t max_seen = 1 << 20;   // remembered candidates per island
+
+// keys smaller first, as in design_sorter, then search order
+struct score final
+{
+    double keys[sort_order::max_keys] = {};
+    std::uint64_t seq = 0;
+};
+
+struct score_less final
+{
+    int num_keys;
+
+    bool operator()(const score& a, const score& b) const
+    {
+        for (int i = 0; i < num_keys; i++)
+            if (a.keys[i] != b.keys[i])
+                return a.keys[i] < b.keys[i];
+        return a.seq < b.seq;
+    }
+};
+
+struct island final
+{
+    std::mt19937_64 rng;
+    filter filter_ship, filter_mission, filter_duel;
+    struct seen_ final { bool ok; score sc; };
+    std::unordered_map<std::uint64_t, seen_> seen; // by seq
+    candidate at, best;
+    score at_score, best_score;
+    bool at_ok = false, has_best = false;
+    std::uint64_t steps = 0, built = 0;
+    ship st;
+
+    // mt19937_64 is the same everywhere, the std distributions aren't
+    int uniform(int lo, int hi) { return lo + (int)(rng() % (std::uint64_t)(hi - lo + 1)); }
+    double uniform() { return (double)(rng() >> 11) * 0x1p-53; }
+};
+
+struct anytime_search final
+{
+    const ship& base;
+    const cmdline& params;
+    const search_kernel& kernel = search_kernel::select();
+    sort_order::key keys[sort_order::max_keys];
+    score_less less{ params.sort.enabled() ? params.sort.num_keys : 1 };
+    std::vector<island> islands;
+    const clock::time_point start = clock::now();
+    const clock::time_point deadline = start + std::chrono::seconds{params.anytime.secs};
+
+    std::mutex lock;
+    std::map<score, ship, score_less> found{less}; // the best -n
+    const std::size_t wanted = params.num_matches == INT_MAX ? 1u : (std::size_t)params.num_matches;
+    std::condition_variable epoch_done;
+    int arrived = 0;
+    unsigned epoch = 0;
+    bool stop = false;
+
+    anytime_search(const ship& base, const cmdline& params);
+
+    score score_of(const ship& st) const;
+    bool accept(island& x, const score& sc) const;
+    candidate random_candidate(island& x) const;
+    candidate neighbor(island& x, const candidate& c) const;
+    bool evaluate(island& x, const candidate& c, score& sc, int i);
+    void offer(const ship& st, const score& sc, int i);
+    void step(island& x, int i);
+    bool end_epoch();
+    void migrate();
+    void run(int i);
+};
+
+anytime_search::anytime_search(const ship& base, const cmdline& params) :
+    base{base}, params{params}
+{
+    if (params.sort.enabled())
+        std::copy(std::begin(params.sort.keys), std::end(params.sort.keys), keys);
+    else
+        keys[0] = { metric::cost, false };
+    for (int i = 0; i < params.anytime.islands; i++)
+        islands.push_back({ std::mt19937_64{params.anytime.seed + (std::uint64_t)i * 0x9e3779b97f4a7c15},
+                            filter::compile(params), filter::compile(params, metric_info::mission),
+                            filter::compile(params, metric_info::duel) });
+}
+
+score anytime_search::score_of(const ship& st) const
+{
+    score sc;
+    for (int i = 0; i < less.num_keys; i++)
+    {
+        double x = metric_value(st, keys[i].m);
+        sc.keys[i] = std::isnan(x) ? HUGE_VAL : keys[i].descending ? -x : x;
+    }
+    sc.seq = st.seq;
+    return sc;
+}
+
+// downhill always, uphill less and less often as the island cools. how far
+// uphill is the first key that got worse, relative to where it was.
+bool anytime_search::accept(island& x, const score& sc) const
+{
+    if (!x.at_ok || !less(x.at_score, sc))
+        return true;
+    int i = 0;
+    while (i < less.num_keys && sc.keys[i] == x.at_score.keys[i])
+        i++;
+    if (i == less.num_keys)
+        return true;
+    const double from = x.at_score.keys[i];
+    const double worse = (sc.keys[i] - from) / std::max(std::fabs(from), 1e-9);
+    const double t = t_hot * std::pow(t_cold / t_hot, (double)(x.steps % cycle_steps) / cycle_steps);
+    return x.uniform() < std::exp(-worse / t);
+}
+
+candidate anytime_search::random_candidate(island& x) const
+{
+    const auto& p = params;
+    candidate c;
+    const int F = x.uniform(p.fixed_engines.min, p.use_big_engines ? p.engines.max : p.fixed_engines.max);
+    const int N = x.uniform(p.engines.min, p.engines.max);
+    c.d30s = p.use_big_engines ? x.uniform(0, F) : F;
+    c.rd51 = F - c.d30s;
+    c.d30 = x.uniform(0, N);
+    c.nk25 = p.use_big_engines ? x.uniform(0, N - c.d30) : N - c.d30;
+    c.rd59 = N - c.d30 - c.nk25;
+    c.big_tanks = p.use_big_tanks && x.uniform(0, 1);
+    // ranges only, so that the same seed finds the same without them
+    if (p.chassis.enabled())
+        for (std::size_t k = 0; k < p.chassis.min.size(); k++)
+            c.legs[k] = p.chassis.min[k] == p.chassis.max[k] ? p.chassis.min[k]
+                                                              : x.uniform(p.chassis.min[k], p.chassis.max[k]);
+    c.fire = p.extinguishers.min == p.extinguishers.max ? p.extinguishers.min
+                                                        : x.uniform(p.extinguishers.min, p.extinguishers.max);
+    c.power = power_steps(p) > 1 ? x.uniform(0, power_steps(p) - 1) : 0;
+    return c;
+}
+
+// one engine more or less, one swapped for another kind, a leg, an
+// extinguisher or a power step more or less, or the other tanks
+candidate anytime_search::neighbor(island& x, const candidate& c) const
+{
+    constexpr int max_tries = 16;
+    const int kinds = params.use_big_engines ? 5 : 3;
+    const bool variants = variant_space(params) > 1;
+    const int moves = 2 + (variants ? 1 : 0) + (params.use_big_tanks ? 1 : 0);
+    for (int tries = 0; tries < max_tries; tries++)
+    {
+        candidate n = c;
+        int* small[] = { &n.d30s, &n.d30, &n.nk25, &n.rd51, &n.rd59 };
+        int* other[] = { &n.legs[0], &n.legs[1], &n.legs[2], &n.legs[3], &n.fire, &n.power };
+        switch (x.uniform(0, moves - 1))
+        {
+        case 0:
+            *small[x.uniform(0, kinds - 1)] += x.uniform(0, 1) ? 1 : -1;
+            break;
+        case 1:
+            (*small[x.uniform(0, kinds - 1)])--;
+            (*small[x.uniform(0, kinds - 1)])++;
+            break;
+        case 2:
+            if (variants)
+            {
+                // in_space() turns down what has no range
+                *other[x.uniform(0, (int)std::size(other) - 1)] += x.uniform(0, 1) ? 1 : -1;
+                break;
+            }
+            [[fallthrough]];
+        default:
+            n.big_tanks = !n.big_tanks;
+            break;
+        }
+        if (in_space(params, n) && candidate_seq(params, n) != candidate_seq(params, c))
+            return n;
+    }
+    return c;
+}
+
+bool anytime_search::evaluate(island& x, const candidate& c, score& sc, int i)
+{
+    const std::uint64_t seq = candidate_seq(params, c);
+    if (auto it = x.seen.find(seq); it != x.seen.end())
+    {
+        sc = it->second.sc;
+        return it->second.ok;
+    }
+    if (x.seen.size() >= max_seen)
+        x.seen.clear();
+    const bool ok = kernel.build(base, x.st, params, c, x.filter_ship, x.filter_mission, x.filter_duel);
+    x.built++;
+    if (ok)
+    {
+        sc = score_of(x.st);
+        offer(x.st, sc, i);
+    }
+    x.seen.emplace(seq, island::seen_{ ok, sc });
+    return ok;
+}
+
+void anytime_search::offer(const ship& st, const score& sc, int i)
+{
+    std::lock_guard<std::mutex> l{lock};
+    if (found.size() == wanted && !less(sc, found.rbegin()->first))
+        return;
+    const auto [it, added] = found.emplace(sc, st);
+    if (!added)
+        return;
+    if (found.size() > wanted)
+        found.erase(std::prev(found.end()));
+    if (it != found.begin())
+        return;
+    fprintf(stderr, "anytime: %.1fs, island %d:", seconds(clock::now() - start).count(), i);
+    for (int k = 0; k < less.num_keys; k++)
+        fprintf(stderr, "%s %s %g", k ? "," : "", metric_info_of(keys[k].m).name, metric_value(st, keys[k].m));
+    fprintf(stderr, "\n");
+    fflush(stderr);
+}
+
+void anytime_search::step(island& x, int i)
+{
+    // every cycle heats up again, from the island's best or from anywhere
+    if (x.steps && !(x.steps % cycle_steps))
+    {
+        x.at_ok = x.has_best && x.uniform(0, 1);
+        x.at = x.best;
+        x.at_score = x.best_score;
+    }
+    const candidate c = x.at_ok ? neighbor(x, x.at) : random_candidate(x);
+    score sc;
+    if (evaluate(x, c, sc, i) && accept(x, sc))
+    {
+        x.at = c;
+        x.at_score = sc;
+        x.at_ok = true;
+        if (!x.has_best || less(sc, x.best_score))
+        {
+            x.best = c;
+            x.best_score = sc;
+            x.has_best = true;
+        }
+    }
+    x.steps++;
+}
+
+// each island moves on from the best of the one before it, when that's
+// better than where it is
+void anytime_search::migrate()
+{
+    struct best_ final { candidate c; score sc; bool ok; };
+    std::vector<best_> from;
+    for (const auto& x : islands)
+        from.push_back({ x.best, x.best_score, x.has_best });
+    for (std::size_t i = 0; i < islands.size(); i++)
+    {
+        auto& x = islands[(i + 1) % islands.size()];
+        const auto& y = from[i];
+        if (!y.ok || (x.at_ok && !less(y.sc, x.at_score)))
+            continue;
+        x.at = y.c;
+        x.at_score = y.sc;
+        x.at_ok = true;
+        if (!x.has_best || less(y.sc, x.best_score))
+        {
+            x.best = y.c;
+            x.best_score = y.sc;
+            x.has_best = true;
+        }
+    }
+}
+
+// islands wait for each other between epochs, so that what they trade
+// doesn't depend on how the threads got scheduled
+bool anytime_search::end_epoch()
+{
+    std::unique_lock<std::mutex> l{lock};
+    const unsigned e = epoch;
+    if (++arrived < (int)islands.size())
+    {
+        epoch_done.wait(l, [&] { return epoch != e; });
+        return !stop;
+    }
+    arrived = 0;
+    migrate();
+    stop = clock::now() >= deadline;
+    epoch++;
+    epoch_done.notify_all();
+    return !stop;
+}
+
+void anytime_search::run(int i)
+{
+    trace::name_thread("island");
+    auto& x = islands[(std::size_t)i];
+    do
+    {
+        trace_span t{"epoch"};
+        for (unsigned k = 0; k < epoch_steps; k++)
+            step(x, i);
+    }
+    while (end_epoch());
+}
+
+} // namespace
+
+int design_anytime(const ship& base, const cmdline& params)
+{
+    if (!search_space(params))
+    {
+        WARN("no designs could be generated within the constraints.");
+        return 1;
+    }
+    anytime_search s{base, params};
+    {
+        std::vector<std::thread> threads;
+        for (int i = 1; i < params.anytime.islands; i++)
+            threads.emplace_back(&anytime_search::run, &s, i);
+        s.run(0);
+        for (auto& t : threads)
+            t.join();
+    }
+
+    std::uint64_t built = 0;
+    for (const auto& x : s.islands)
+        built += x.built;
+    fprintf(stderr, "anytime: %llu candidates built in %u epochs of %d islands, %.1fs\n",
+            (unsigned long long)built, s.epoch, params.anytime.islands,
+            seconds(clock::now() - s.start).count());
+    if (s.found.empty())
+    {
+        WARN("no designs could be generated within the constraints.");
+        return 1;
+    }
+    report_begin(params);
+    int k = 0;
+    for (const auto& [sc, st] : s.found)
+        report(st, k, params) && k++;
+    fflush(stdout);
+    return 0;
+}
+
+} // namespace hf::design
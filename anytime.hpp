@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+
+namespace hf::design {
+
+struct ship;
+struct cmdline;
+
+// --anytime: simulated annealing over the candidates for 'secs' seconds
+// rather than walking all of them. 'islands' anneal side by side, each on
+// a thread of its own with a generator seeded from 'seed', and trade
+// their best candidates every so many steps. the same seed and number of
+// steps finds the same designs.
+struct anytime_options final
+{
+    int secs = 0;
+    int islands = 4;
+    std::uint64_t seed = 1;
+
+    bool enabled() const { return secs > 0; }
+};
+
+// prints the best -n designs found (1 by default) in --sort order, or by
+// cost without it. improvements go to stderr as they're found.
+int design_anytime(const ship& base, const cmdline& params);
+
+} // namespace hf::design
@@ -0,0 +1,218 @@
+#include "atlas.hpp"
+#include "part.hpp"
+#include "ship.hpp"
+#include "cmdline.hpp"
+#include "search.hpp"
+#include "space.hpp"
+#include "filter.hpp"
+#include "defs.hpp"
+#include "log.hpp"
+
+#include "getopt.h"
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// precomputes the designs of common queries for hf-design, see atlas.hpp.
+// the build runs it over HF_DESIGN_ATLAS whenever the search changes and
+// compiles what it writes into hf-design.
+
+namespace hf::design {
+
+namespace {
+
+struct query final
+{
+    std::string text;
+    std::vector<std::string> words;
+    ship base;
+    cmdline params = parse(*this);
+    std::uint64_t num_designs = 0;
+    std::vector<unsigned char> seqs;
+
+    explicit query(const char* text) : text{text} {}
+
+private:
+    static cmdline parse(query& q);
+};
+
+// the words of the query as hf-design would take them
+cmdline query::parse(query& q)
+{
+    q.words.emplace_back("hf-design");
+    for (const char* s = q.text.c_str(); *s; )
+    {
+        const std::size_t n = strcspn(s, " \t");
+        if (n)
+            q.words.emplace_back(s, n);
+        s += n + strspn(s + n, " \t");
+    }
+    std::vector<const char*> argv;
+    for (const auto& w : q.words)
+        argv.push_back(w.c_str());
+    argv.push_back(nullptr);
+
+    musl_optind = 0; // getopt starts over
+    const int argc = (int)q.words.size();
+    auto p = cmdline::parse_options(argc, argv.data());
+    p.argv = nullptr;
+    if (p.where || p.mission.enabled || p.duel.enabled || p.use_layout || p.explain || p.summary ||
+        p.sort.enabled() || p.fleet.enabled() || p.anytime.enabled() || p.use_shards || p.checkpoint ||
+        p.dry_run || p.num_matches != INT_MAX || p.format != cmdline::fmt_default || p.columns.enabled() ||
+        p.eval || p.catalog_file)
+    {
+        ERR("'%s': only guns, construction and -T -H -u -c -E go in the atlas", q.text.c_str());
+        terminate(EX_USAGE);
+    }
+    if (musl_optind == argc)
+    {
+        ERR("'%s': no guns", q.text.c_str());
+        terminate(EX_USAGE);
+    }
+    for (int i = musl_optind; i < argc; i++)
+        if (!add_gun(q.base, argv[(std::size_t)i]))
+            terminate(EX_USAGE);
+    return p;
+}
+
+// every candidate on its own, checked against the walk
+void find_designs(query& q)
+{
+    const auto& kernel = search_kernel::select();
+    const auto& p = q.params;
+    filter filter_ship = filter::compile(p);
+    filter filter_mission = filter::compile(p, metric_info::mission);
+    filter filter_duel = filter::compile(p, metric_info::duel);
+    const std::uint64_t total = search_space(p) * (unsigned)search_passes(p);
+    ship st;
+
+    // runs of designs, each after a run of candidates that make none
+    std::vector<std::uint64_t> runs;
+    std::uint64_t next = 0; // candidate after the last run
+    for (std::uint64_t seq = 0; seq < total; seq++)
+    {
+        const candidate c = candidate_at(p, seq);
+        ASSERT(candidate_seq(p, c) == seq);
+        if (!kernel.build(q.base, st, p, c, filter_ship, filter_mission, filter_duel))
+            continue;
+        if (runs.empty() || seq != next)
+            runs.insert(runs.end(), { seq - next, 0 });
+        runs.back()++;
+        next = seq + 1;
+        q.num_designs++;
+    }
+    q.seqs.resize(runs.size() * 10);
+    unsigned char* out = q.seqs.data();
+    for (std::uint64_t x : runs)
+        put_varint(out, x);
+    q.seqs.resize((std::size_t)(out - q.seqs.data()));
+
+    search_control control;
+    control.quiet = true;
+    search_candidates(q.base, p, 0, total, control);
+    if ((std::uint64_t)control.num_designs != q.num_designs)
+        ABORT("'%s': %llu designs, the walk found %d", q.text.c_str(),
+              (unsigned long long)q.num_designs, control.num_designs);
+}
+
+void write_bounds(FILE* f, float lo, float hi)
+{
+    fprintf(f, " { %a, %a },", (double)lo, (double)hi);
+}
+
+void write_atlas(FILE* f, const std::vector<query>& queries)
+{
+    fprintf(f, "// generated by hf-design-atlas, do not edit\n\n");
+    fprintf(f, "#include \"atlas.hpp\"\n\n");
+    fprintf(f, "namespace hf::design {\n\nnamespace {\n\n");
+    for (std::size_t i = 0; i < queries.size(); i++)
+    {
+        const auto& s = queries[i].seqs;
+        fprintf(f, "const unsigned char seqs_%zu[] = {", i);
+        for (std::size_t k = 0; k < s.size(); k++)
+            fprintf(f, "%s0x%02x,", k % 16 ? " " : "\n    ", s[k]);
+        fprintf(f, "%s\n};\n\n", s.empty() ? "\n    0" : "");
+    }
+    if (!queries.empty())
+    {
+        fprintf(f, "const atlas_entry entries[] = {\n");
+        for (std::size_t i = 0; i < queries.size(); i++)
+        {
+            const auto& q = queries[i];
+            const auto& p = q.params;
+            fprintf(f, "    { \"%s\", 0x%016llxull,", q.text.c_str(), (unsigned long long)atlas_key(q.base, p));
+            write_bounds(f, p.twr.min, p.twr.max);
+            write_bounds(f, p.horizontal_twr.min, p.horizontal_twr.max);
+            write_bounds(f, p.fuel_usage.min, p.fuel_usage.max);
+            fprintf(f, " { %d, %d }, %d,\n      %lluu, seqs_%zu, %zu },\n", p.cost.min, p.cost.max,
+                    (int)p.engine_parity, (unsigned long long)q.num_designs, i, q.seqs.size());
+        }
+        fprintf(f, "};\n\n");
+        fprintf(f, "const atlas_table table{ entries, sizeof(entries) / sizeof(*entries) };\n\n");
+    }
+    fprintf(f, "} // namespace\n\n} // namespace hf::design\n");
+}
+
+[[noreturn]] void usage(const char* argv0)
+{
+    printf("usage: %s <file.cpp> <query>...\n", argv0);
+    printf("this program precomputes hf-design queries into a source file.\n\n");
+    printf("  %-29s %s\n", "<query>", "hf-design arguments in one word, e.g. '-b 2:130mm'");
+    printf("  %-29s %s\n", "-h", "this screen");
+    printf("\nqueries take guns, construction settings and -T -H -u -c -E.\n");
+    fflush(stdout);
+    terminate(stdout == stderr ? EX_USAGE : 0);
+}
+
+} // namespace
+
+extern "C" int main(int argc, char** argv)
+{
+#ifdef _WIN32
+    if (const char* c = strrchr(argv[0], '.'); c && *c)
+        argv[0][c - argv[0]] = '\0';
+    argv[0] = std::max(argv[0], strrchr(argv[0], '\\')+1);
+#endif
+    argv[0] = std::max(argv[0], strrchr(argv[0], '/')+1);
+
+    try {
+        if (argc < 2 || !strcmp(argv[1], "-h"))
+            usage(argv[0]);
+
+        std::vector<query> queries;
+        queries.reserve((std::size_t)argc);
+        for (int i = 2; i < argc; i++)
+        {
+            auto& q = queries.emplace_back(argv[i]);
+            find_designs(q);
+            INFO("%s: %llu designs of %llu candidates, %zu bytes", q.text.c_str(),
+                 (unsigned long long)q.num_designs,
+                 (unsigned long long)(search_space(q.params) * (unsigned)search_passes(q.params)), q.seqs.size());
+        }
+
+        // written whole or not at all, so a failed run can't leave a
+        // table the build takes as current
+        const std::string tmp = std::string{argv[1]} + ".tmp";
+        FILE* f = fopen(tmp.c_str(), "w");
+        if (!f)
+        {
+            ERR("%s: %s", tmp.c_str(), strerror(errno));
+            terminate(EX_CANTCREAT);
+        }
+        write_atlas(f, queries);
+        if (fclose(f) || (remove(argv[1]), rename(tmp.c_str(), argv[1])))
+        {
+            ERR("%s: %s", argv[1], strerror(errno));
+            terminate(EX_IOERR);
+        }
+        return 0;
+    } catch (const exit_status& x) {
+        return x.code;
+    }
+}
+
+} // namespace hf::design
@@ -0,0 +1,152 @@
+#include "atlas.hpp"
+#include "search.hpp"
+#include "space.hpp"
+#include "filter.hpp"
+#include "trace.hpp"
+#include "part.hpp"
+#include "ship.hpp"
+#include "cmdline.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace hf::design {
+
+namespace {
+
+auto& static_entries()
+{
+    static std::vector<const atlas_entry*> ret;
+    return ret;
+}
+
+template<typename t>
+void mix(std::uint64_t& h, const t& x)
+{
+    const auto* s = (const unsigned char*)&x;
+    for (std::size_t i = 0; i < sizeof(x); i++)
+        h = (h ^ s[i]) * 0x100000001b3;
+}
+
+template<typename t>
+bool within(const interval<t>& query, const t (&bounds)[2])
+{
+    return query.min >= bounds[0] && query.max <= bounds[1];
+}
+
+const atlas_entry* find_entry(const ship& base, const cmdline& params)
+{
+    const auto& entries = static_entries();
+    if (entries.empty())
+        return nullptr;
+    const std::uint64_t key = atlas_key(base, params);
+    for (const auto* x : entries)
+        if (x->key == key && within(params.twr, x->twr) && within(params.horizontal_twr, x->horizontal_twr) &&
+            within(params.fuel_usage, x->fuel_usage) && within(params.cost, x->cost) &&
+            ((cmdline::parity)x->parity == cmdline::parity::any || (cmdline::parity)x->parity == params.engine_parity))
+            return x;
+    return nullptr;
+}
+
+} // namespace
+
+atlas_table::atlas_table(const atlas_entry* entries, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; i++)
+        static_entries().push_back(&entries[i]);
+}
+
+std::uint64_t atlas_key(const ship& base, const cmdline& p)
+{
+    std::uint64_t h = 0xcbf29ce484222325;
+    for (const auto* x : part::all_parts())
+        if (const int n = base.count(*x))
+        {
+            mix(h, x->index);
+            mix(h, n);
+        }
+    for (const auto* x : { &p.engines, &p.fixed_engines, &p.extinguishers })
+    {
+        mix(h, x->min);
+        mix(h, x->max);
+    }
+    mix(h, p.power.min);
+    mix(h, p.power.max);
+    mix(h, p.chassis.nlegs);
+    mix(h, p.chassis.min);
+    mix(h, p.chassis.max);
+    mix(h, p.armor_layers);
+    mix(h, p.extra_mass);
+    mix(h, p.extra_power);
+    mix(h, p.combat_time);
+    mix(h, p.use_big_tanks);
+    mix(h, p.use_big_engines);
+    return h;
+}
+
+void put_varint(unsigned char*& out, std::uint64_t x)
+{
+    for (; x >= 0x80; x >>= 7)
+        *out++ = (unsigned char)(x | 0x80);
+    *out++ = (unsigned char)x;
+}
+
+std::uint64_t get_varint(const unsigned char*& in)
+{
+    std::uint64_t x = 0;
+    for (int shift = 0; ; shift += 7)
+    {
+        const unsigned char c = *in++;
+        x |= (std::uint64_t)(c & 0x7f) << shift;
+        if (!(c & 0x80))
+            return x;
+    }
+}
+
+// layouts take a time budget and duels a thread pool, the walk does
+// those better. --explain wants the designs the filters turn down too.
+bool atlas_search(const ship& base, const cmdline& params,
+                  std::uint64_t begin, std::uint64_t end, search_control& control)
+{
+    // the atlas was searched with the built-in part values
+    if (!params.use_atlas || params.use_layout || params.duel.enabled || control.explain || control.ckpt ||
+        params.catalog != &part_catalog::builtin())
+        return false;
+    const atlas_entry* x = find_entry(base, params);
+    if (!x)
+        return false;
+
+    trace_span t{"atlas"};
+    const auto& kernel = search_kernel::select();
+    filter filter_ship = filter::compile(params);
+    filter filter_mission = filter::compile(params, metric_info::mission);
+    filter filter_duel = filter::compile(params, metric_info::duel);
+    const std::uint64_t searched = control.searched.load(std::memory_order_relaxed);
+    ship st;
+
+    // runs of designs after runs of candidates that make none
+    const unsigned char* in = x->seqs;
+    std::uint64_t seq = 0, left = 0;
+    for (std::uint32_t i = 0; i < x->num_designs && control.num_designs < params.num_matches; i++, seq++)
+    {
+        if (!left)
+        {
+            seq += get_varint(in);
+            left = get_varint(in);
+        }
+        left--;
+        if (seq < begin)
+            continue;
+        if (seq >= end)
+            break;
+        if (kernel.build(base, st, params, candidate_at(params, seq), filter_ship, filter_mission, filter_duel))
+            report_design(control, st, params);
+        control.searched.store(searched + seq - begin, std::memory_order_relaxed);
+        control.designs.store(control.num_designs, std::memory_order_relaxed);
+    }
+    control.searched.store(searched + (end - begin), std::memory_order_relaxed);
+    return true;
+}
+
+} // namespace hf::design
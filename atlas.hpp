@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace hf::design {
+
+struct ship;
+struct cmdline;
+struct search_control;
+
+// designs of common queries, found at build time by hf-design-atlas and
+// compiled into hf-design. an entry is one query's guns and construction
+// settings, the bounds of its built-in constraints and the seqs of the
+// designs that met them: varints, pairs of candidates that make none and
+// designs in a row after them. a query with the same guns and
+// construction and constraints within those bounds gets its designs by
+// building the entry's candidates only, --where and the rest of the
+// filters on top, in the search's order.
+struct atlas_entry final
+{
+    const char* query;          // as hf-design-atlas got it
+    std::uint64_t key;          // atlas_key() of it
+    float twr[2], horizontal_twr[2], fuel_usage[2];
+    int cost[2];
+    char parity;                // cmdline::parity
+    std::uint32_t num_designs;
+    const unsigned char* seqs;
+    std::size_t size;
+};
+
+// the generated entries register themselves from a static constructor,
+// so programs built without them simply have none
+struct atlas_table final
+{
+    atlas_table(const atlas_entry* entries, std::size_t count);
+};
+
+// guns and whatever the walk builds designs from, nothing that filters
+std::uint64_t atlas_key(const ship& base, const cmdline& params);
+
+void put_varint(unsigned char*& out, std::uint64_t x);
+std::uint64_t get_varint(const unsigned char*& in);
+
+// candidates [begin, end) from the atlas. false, with nothing done, if it
+// has no entry for the query or the search needs more than designs.
+bool atlas_search(const ship& base, const cmdline& params,
+                  std::uint64_t begin, std::uint64_t end, search_control& control);
+
+} // namespace hf::design
@@ -0,0 +1,286 @@
+#include "best-first.hpp"
+#include "search.hpp"
+#include "space.hpp"
+#include "cmdline.hpp"
+#include "filter.hpp"
+#include "metric.hpp"
+#include "part-list.hpp"
+#include "ship.hpp"
+#include "trace.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <queue>
+#include <vector>
+
+namespace hf::design {
+
+namespace {
+
+// float sums of the real ships can land an ulp or so either side
+constexpr double margin = 1e-5;
+
+constexpr int num_engine_kinds = 5;
+const part* const engine_kinds[num_engine_kinds] = { &e_d30s, &e_rd51, &e_d30, &e_nk25, &e_rd59 };
+
+// what one engine of a kind adds to a ship, its hull included
+struct engine_share final
+{
+    double mass, thrust, horizontal_thrust, fuel_flow;
+    int cost;
+};
+
+// of every design on a set of engines. twr, htwr upper bounds, cost,
+// mass and fuel usage lower ones, thrusts and fuel flow all but exact.
+struct bounds final
+{
+    double twr, horizontal_twr, cost, mass, fuel_usage;
+    double thrust, horizontal_thrust, fuel_flow;
+};
+
+struct item final
+{
+    float priority; // smaller first, never above the bound it stands for
+    std::uint32_t engines; // index among engine_space()
+};
+
+struct item_after final
+{
+    bool operator()(const item& a, const item& b) const
+    {
+        return a.priority != b.priority ? a.priority > b.priority : a.engines > b.engines;
+    }
+};
+
+struct best_first final
+{
+    const ship& base;
+    const cmdline& params;
+    search_control& control;
+    const search_kernel& kernel = search_kernel::select();
+    filter filter_ship = filter::compile(params);
+    filter filter_mission = filter::compile(params, metric_info::mission);
+    filter filter_duel = filter::compile(params, metric_info::duel);
+    engine_share shares[num_engine_kinds];
+    // the --sort key, and the -n best of it so far when it has a bound
+    const sort_order::key* key = params.sort.enabled() ? &params.sort.keys[0] : nullptr;
+    std::priority_queue<double> kept;
+    bool bounded = false;
+    ship st;
+
+    best_first(const ship& base, const cmdline& params, search_control& control);
+
+    bounds bounds_of(const int (&counts)[num_engine_kinds]) const;
+    bool makes_nothing(const bounds& b) const;
+    double key_bound(const bounds& b) const;
+    float priority(const bounds& b) const;
+    std::vector<item> order();
+    void keep(const ship& x);
+    bool done(const item& x) const;
+    void run();
+};
+
+best_first::best_first(const ship& base, const cmdline& params, search_control& control) :
+    base{base}, params{params}, control{control}
+{
+    const ship none{*base.catalog};
+    for (int i = 0; i < num_engine_kinds; i++)
+    {
+        ship x{*base.catalog};
+        x.add_part(*engine_kinds[i], 1);
+        shares[i] = { (double)x.mass - none.mass, (double)x.thrust - none.thrust,
+                      (double)x.horizontal_thrust - none.horizontal_thrust,
+                      (double)x.fuel_flow - none.fuel_flow, x.cost - none.cost };
+    }
+    // the key has a bound if it has one for a ship of nothing but the guns
+    bounded = key && key_bound(bounds_of({})) != -HUGE_VAL;
+}
+
+bounds best_first::bounds_of(const int (&counts)[num_engine_kinds]) const
+{
+    bounds b;
+    double mass = (double)base.mass + params.extra_mass, cost = base.cost;
+    b.thrust = base.thrust;
+    b.horizontal_thrust = base.horizontal_thrust;
+    b.fuel_flow = base.fuel_flow;
+    for (int i = 0; i < num_engine_kinds; i++)
+    {
+        const auto& x = shares[i];
+        mass += x.mass * counts[i];
+        cost += x.cost * counts[i];
+        b.thrust += x.thrust * counts[i];
+        b.horizontal_thrust += x.horizontal_thrust * counts[i];
+        b.fuel_flow += x.fuel_flow * counts[i];
+    }
+    b.mass = mass * (1 - margin);
+    b.cost = cost;
+    b.twr = b.mass > 0 ? b.thrust * 1000 / (b.mass * 9.81) * (1 + margin) : HUGE_VAL;
+    b.horizontal_twr = b.mass > 0 ? b.horizontal_thrust * 1000 / (b.mass * 9.81) * (1 + margin) : HUGE_VAL;
+    b.fuel_usage = b.twr > 0 ? 3600 * 20 * b.fuel_flow * (1 - margin) / (b.twr * 90) : HUGE_VAL;
+    return b;
+}
+
+bool best_first::makes_nothing(const bounds& b) const
+{
+    return b.twr < params.twr.min || b.horizontal_twr < params.horizontal_twr.min ||
+           b.cost > params.cost.max || b.fuel_usage > params.fuel_usage.max;
+}
+
+// of the sort key as the sorter keeps it, smaller first. -inf without one.
+double best_first::key_bound(const bounds& b) const
+{
+    double lo = -HUGE_VAL, hi = HUGE_VAL;
+    switch (key ? key->m : metric::cost)
+    {
+    case metric::cost:              lo = b.cost; break;
+    case metric::mass:              lo = b.mass; break;
+    case metric::fuel_usage:        lo = b.fuel_usage; break;
+    case metric::twr:               hi = b.twr; break;
+    case metric::horizontal_twr:    hi = b.horizontal_twr; break;
+    case metric::speed:             hi = b.twr * 90; break;
+    case metric::thrust:            lo = b.thrust * (1 - margin); hi = b.thrust * (1 + margin); break;
+    case metric::horizontal_thrust: lo = b.horizontal_thrust * (1 - margin); hi = b.horizontal_thrust * (1 + margin); break;
+    case metric::fuel_flow:         lo = b.fuel_flow * (1 - margin); hi = b.fuel_flow * (1 + margin); break;
+    default: break;
+    }
+    if (!key)
+        return -HUGE_VAL;
+    return key->descending ? -hi : lo;
+}
+
+// the sort key's bound, or with none how far the bounds clear the
+// constraints: the least of their ratios, larger first
+float best_first::priority(const bounds& b) const
+{
+    double x = key_bound(b);
+    if (x == -HUGE_VAL)
+    {
+        double slack = HUGE_VAL;
+        if (params.twr.min > 0)
+            slack = std::min(slack, b.twr / params.twr.min);
+        if (params.horizontal_twr.min > 0)
+            slack = std::min(slack, b.horizontal_twr / params.horizontal_twr.min);
+        if (params.cost.max < INT_MAX)
+            slack = std::min(slack, params.cost.max / std::max(b.cost, 1.));
+        if (params.fuel_usage.max < cmdline::float_max && b.fuel_usage > 0)
+            slack = std::min(slack, params.fuel_usage.max / b.fuel_usage);
+        x = slack == HUGE_VAL ? 0 : -slack;
+    }
+    auto ret = (float)x;
+    if ((double)ret > x)
+        ret = std::nextafter(ret, -HUGE_VALF);
+    return ret;
+}
+
+// the sets of engines in the order search_engines() walks them
+std::vector<item> best_first::order()
+{
+    trace_span t{"order"};
+    std::vector<item> ret;
+    ASSERT(engine_space(params) <= UINT32_MAX);
+    ret.reserve((std::size_t)engine_space(params));
+    std::uint32_t e = 0;
+    int n[num_engine_kinds] = {}; // d30s, rd51, d30, nk25, rd59
+    const auto add = [&] {
+        const bounds b = bounds_of(n);
+        if (!makes_nothing(b))
+            ret.push_back({ priority(b), e });
+        e++;
+    };
+    const int lo = params.engines.min, hi = params.engines.max;
+    if (params.use_big_engines)
+        for (int F = params.fixed_engines.min; F <= hi; F++)
+            for (n[0] = 0; n[0] <= F; n[0]++)
+            {
+                n[1] = F - n[0];
+                for (int N = lo; N <= hi; N++)
+                    for (n[2] = 0; n[2] <= N; n[2]++)
+                        for (n[3] = 0; n[3] <= N - n[2]; n[3]++)
+                        {
+                            n[4] = N - n[2] - n[3];
+                            add();
+                        }
+            }
+    else
+        for (n[0] = params.fixed_engines.min; n[0] <= params.fixed_engines.max; n[0]++)
+            for (int N = lo; N <= hi; N++)
+                for (n[2] = 0; n[2] <= N; n[2]++)
+                {
+                    n[3] = N - n[2];
+                    add();
+                }
+    ASSERT(e == engine_space(params));
+    return ret;
+}
+
+void best_first::keep(const ship& x)
+{
+    double v = metric_value(x, key->m);
+    if (std::isnan(v))
+        v = HUGE_VAL;
+    else if (key->descending)
+        v = -v;
+    if (kept.size() < (std::size_t)params.num_matches)
+        kept.push(v);
+    else if (v < kept.top())
+    {
+        kept.pop();
+        kept.push(v);
+    }
+}
+
+// with -n sorted designs in hand, a set whose bound is worse than the
+// last of them can't put one in, nor can any after it
+bool best_first::done(const item& x) const
+{
+    if (!control.sorter)
+        return control.num_designs >= params.num_matches;
+    return bounded && kept.size() == (std::size_t)params.num_matches && (double)x.priority > kept.top();
+}
+
+void best_first::run()
+{
+    std::priority_queue<item, std::vector<item>, item_after> queue{item_after{}, order()};
+    const std::uint64_t space = search_space(params), variants = variant_space(params);
+    const int passes = search_passes(params);
+    std::uint64_t searched = control.searched.load(std::memory_order_relaxed);
+    // the sets passed over
+    searched += (engine_space(params) - queue.size()) * variants * (unsigned)passes;
+
+    trace_span t{"best-first"};
+    for (; !queue.empty(); queue.pop())
+    {
+        const item& x = queue.top();
+        if (done(x))
+            break;
+        for (int pass = 0; pass < passes; pass++)
+            for (std::uint64_t v = 0; v < variants; v++)
+            {
+                const std::uint64_t seq = space * (unsigned)pass + x.engines * variants + v;
+                if (!kernel.build(base, st, params, candidate_at(params, seq), filter_ship, filter_mission, filter_duel))
+                    continue;
+                report_design(control, st, params);
+                if (control.sorter && bounded)
+                    keep(st);
+                else if (!control.sorter && control.num_designs >= params.num_matches)
+                    return;
+            }
+        searched += variants * (unsigned)passes;
+        control.searched.store(searched, std::memory_order_relaxed);
+        control.designs.store(control.num_designs, std::memory_order_relaxed);
+    }
+}
+
+} // namespace
+
+void search_best_first(const ship& base, const cmdline& params, search_control& control)
+{
+    if (!search_space(params))
+        return;
+    best_first{base, params, control}.run();
+}
+
+} // namespace hf::design
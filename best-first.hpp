@@ -0,0 +1,21 @@
+#pragma once
+
+namespace hf::design {
+
+struct ship;
+struct cmdline;
+struct search_control;
+
+// --best-first: the sets of engines in order of a bound on what their
+// designs can be, best first, rather than in search order. the bounds come
+// from the engines alone, as every other part only adds mass and cost:
+// twr, htwr and speed from above, cost, mass and fuel usage from below.
+// sets whose bounds miss -T, -H, -c or -u make nothing and are passed
+// over, the rest are ordered by the --sort key's bound, or by how far the
+// bounds clear the constraints. every candidate of a set, of both -b
+// passes, is built before the next set. -n stops it as usual; under --sort
+// it stops once the next set's bound can't beat the -n best so far, so
+// the sorted result is the full search's.
+void search_best_first(const ship& base, const cmdline& params, search_control& control);
+
+} // namespace hf::design
@@ -0,0 +1,261 @@
+#include "catalog.hpp"
+#include "part.hpp"
+#include "part-list.hpp"
+#include "defs.hpp"
+#include "log.hpp"
+
+#include "getopt.h"
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// compiles a list of part values into a snapshot hf-design --catalog
+// maps, see catalog.hpp. the list has a line for each part, name, mass,
+// power, size, price and then thrust, fuel and ammo if any, # for a
+// comment; parts it leaves out keep their built-in values. -p prints
+// the built-in list, or a snapshot's, to start from.
+
+namespace hf::design {
+
+namespace {
+
+constexpr struct { const char* name; part_size size; } sizes[] = {
+    { "1x1", sz_1x1 }, { "1x2", sz_1x2 }, { "2x2", sz_2x2 }, { "4x4", sz_4x4 },
+    { "bigfuel", sz_bigfuel }, { "cor", sz_cor }, { "-", sz_nan },
+};
+
+const char* size_name(int size)
+{
+    for (const auto& x : sizes)
+        if (x.size == size)
+            return x.name;
+    return "?";
+}
+
+// the fewest digits that read back as the same float
+struct shortest final
+{
+    char buf[32];
+
+    explicit shortest(float x)
+    {
+        for (int digits = 6; digits <= 9; digits++)
+        {
+            snprintf(buf, sizeof(buf), "%.*g", digits, (double)x);
+            if (std::strtof(buf, nullptr) == x)
+                break;
+        }
+    }
+};
+
+void print_catalog(const part_catalog& catalog)
+{
+    printf("# %-10s %-10s %-7s %-8s %-7s %-7s %-8s %s\n",
+           "name", "mass", "power", "size", "price", "thrust", "fuel", "ammo");
+    for (const auto* x : part::all_parts())
+    {
+        if (*x == null_part)
+            continue;
+        const part_values& v = catalog[*x];
+        printf("%-12s %-10s %-7s %-8s %-7d %-7s %-8s %d\n", x->name, shortest{v.mass}.buf, shortest{v.power}.buf,
+               size_name(v.size), (int)v.price, shortest{v.thrust}.buf, shortest{v.fuel}.buf, (int)v.ammo);
+    }
+}
+
+struct source final
+{
+    const char* name;
+    int line = 0;
+
+    [[noreturn]] void fail(const char* what, const char* word = nullptr) const
+    {
+        if (word)
+            ERR("%s:%d: %s -- '%s'", name, line, what, word);
+        else
+            ERR("%s:%d: %s", name, line, what);
+        terminate(EX_DATAERR);
+    }
+    float get_float(const char* word) const
+    {
+        char* end;
+        errno = 0;
+        const double x = std::strtod(word, &end);
+        if (end == word || *end || errno || !std::isfinite(x) || std::fabs(x) > 1e9)
+            fail("invalid number", word);
+        return (float)x;
+    }
+    int get_int(const char* word) const
+    {
+        char* end;
+        errno = 0;
+        const long x = std::strtol(word, &end, 10);
+        if (end == word || *end || errno || x < -(1 << 24) || x > 1 << 24)
+            fail("invalid integer", word);
+        return (int)x;
+    }
+};
+
+// the built-in values with those of the list on top
+std::vector<part_values> read_source(const char* name)
+{
+    FILE* f = fopen(name, "r");
+    if (!f)
+    {
+        ERR("%s: %s", name, strerror(errno));
+        terminate(EX_NOINPUT);
+    }
+    const part_catalog& builtin = part_catalog::builtin();
+    std::vector<part_values> ret;
+    for (unsigned i = 0; i < part::all_parts().size(); i++)
+        ret.push_back(builtin[part::at(i)]);
+    std::vector<bool> seen(ret.size());
+
+    source in{name};
+    char buf[1024];
+    while (fgets(buf, sizeof(buf), f))
+    {
+        in.line++;
+        if (!strchr(buf, '\n') && !feof(f))
+            in.fail("line too long");
+        if (char* s = strchr(buf, '#'))
+            *s = '\0';
+        std::vector<const char*> words;
+        for (char* s = strtok(buf, " \t\r\n"); s; s = strtok(nullptr, " \t\r\n"))
+            words.push_back(s);
+        if (words.empty())
+            continue;
+        if (words.size() != 5 && words.size() != 8)
+            in.fail("expected name, mass, power, size, price and maybe thrust, fuel, ammo", words[0]);
+
+        const part& x = part::find_part(words[0]);
+        if (x == null_part)
+            in.fail("no such part", words[0]);
+        if (seen[x.index])
+            in.fail("part listed twice", words[0]);
+        seen[x.index] = true;
+        part_values& v = ret[x.index];
+        const bool gun = v.ammo < 0;
+
+        v.mass = in.get_float(words[1]);
+        v.power = in.get_float(words[2]);
+        // the search lays parts out by their size, it can't change
+        if (strcmp(words[3], size_name(x.size_)))
+            in.fail("the size of the part is built in", words[3]);
+        v.price = in.get_int(words[4]);
+        v.thrust = v.fuel = 0;
+        v.ammo = 0;
+        if (words.size() == 8)
+        {
+            v.thrust = in.get_float(words[5]);
+            v.fuel = in.get_float(words[6]);
+            v.ammo = in.get_int(words[7]);
+        }
+        if ((v.ammo < 0) != gun)
+            in.fail(gun ? "a gun's ammo use must stay below 0" : "only guns use ammo, below 0", words[0]);
+        if (v.mass <= 0 && x.area() > 0)
+            in.fail("a part must weigh something", words[1]);
+        if (v.price < 0)
+            in.fail("price can't be negative", words[4]);
+    }
+    if (ferror(f))
+    {
+        ERR("%s: %s", name, strerror(errno));
+        terminate(EX_IOERR);
+    }
+    fclose(f);
+    return ret;
+}
+
+[[noreturn]] void usage(const char* argv0)
+{
+    printf("usage: %s <parts.txt> <catalog.bin>\n", argv0);
+    printf("       %s -p [<catalog.bin>]\n", argv0);
+    printf("this program compiles part values for hf-design --catalog.\n\n");
+    printf("  %-29s %s\n", "-p", "print the built-in values, or a catalog's");
+    printf("  %-29s %s\n", "-h", "this screen");
+    printf("\neach line is a part's name, mass, power, size, price and, for guns, engines\n"
+           "and tanks, thrust, fuel (below 0 for use) and ammo (below 0 for use), as -p\n"
+           "prints them. parts left out keep the built-in values. sizes and which\n"
+           "parts are guns can't change. a catalog is for the build that made it.\n");
+    printf("\nexample: %s -p > parts.txt; edit parts.txt; %s parts.txt patch.bin\n", argv0, argv0);
+    fflush(stdout);
+    terminate(stdout == stderr ? EX_USAGE : 0);
+}
+
+} // namespace
+
+extern "C" int main(int argc, char** argv)
+{
+#ifdef _WIN32
+    if (const char* c = strrchr(argv[0], '.'); c && *c)
+        argv[0][c - argv[0]] = '\0';
+    argv[0] = std::max(argv[0], strrchr(argv[0], '\\')+1);
+#endif
+    argv[0] = std::max(argv[0], strrchr(argv[0], '/')+1);
+
+    try {
+        bool print = false;
+        for (int c; (c = musl_getopt(argc, argv, "ph")) != -1; )
+            switch (c)
+            {
+            case 'p': print = true; break;
+            case 'h':
+                usage(argv[0]);
+            default:
+                goto error;
+            }
+        if (print)
+        {
+            if (argc - musl_optind > 1)
+            {
+                ERR("-p takes at most one catalog");
+                goto error;
+            }
+            if (musl_optind < argc)
+                print_catalog(part_catalog{argv[musl_optind]});
+            else
+                print_catalog(part_catalog::builtin());
+            fflush(stdout);
+            return 0;
+        }
+        if (musl_optind == argc)
+            usage(argv[0]);
+        if (argc - musl_optind != 2)
+        {
+            ERR("expected a list of parts and a catalog to write");
+            goto error;
+        }
+
+        {
+            const char* out = argv[musl_optind + 1];
+            const auto image = part_catalog::image(read_source(argv[musl_optind]));
+            // written whole or not at all, hf-design may have the old one mapped
+            const std::string tmp = std::string{out} + ".tmp";
+            FILE* f = fopen(tmp.c_str(), "wb");
+            if (!f)
+            {
+                ERR("%s: %s", tmp.c_str(), strerror(errno));
+                terminate(EX_CANTCREAT);
+            }
+            if (fwrite(image.data(), 1, image.size(), f) != image.size() || fclose(f) ||
+                (remove(out), rename(tmp.c_str(), out)))
+            {
+                ERR("%s: %s", out, strerror(errno));
+                terminate(EX_IOERR);
+            }
+        }
+        return 0;
+error:
+        fprintf(stderr, "Try '%s -h' for more information.\n", argv[0]);
+        return EX_USAGE;
+    } catch (const exit_status& x) {
+        return x.code;
+    }
+}
+
+} // namespace hf::design
@@ -0,0 +1,222 @@
+#include "catalog.hpp"
+#include "part.hpp"
+#include "part-list.hpp"
+#include "defs.hpp"
+#include "log.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <utility>
+
+#ifndef _WIN32
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+namespace hf::design {
+
+namespace {
+
+// at the start of a snapshot, then the values, the name index and the
+// names, each at an offset given here
+struct snapshot_header final
+{
+    char magic[sizeof(part_catalog::magic)];
+    std::uint32_t byte_order;
+    std::uint32_t size;             // of the whole snapshot
+    std::uint64_t parts_key;        // parts_key() of the build that made it
+    std::uint64_t checksum;         // of all that comes after the header
+    std::uint32_t num_parts, num_slots;
+    std::uint32_t values_at, slots_at, names_at, reserved;
+};
+
+constexpr std::uint32_t byte_order = 0x01020304;
+
+std::uint64_t hash(const void* data, std::size_t size, std::uint64_t h = 0xcbf29ce484222325)
+{
+    const auto* s = (const unsigned char*)data;
+    for (std::size_t i = 0; i < size; i++)
+        h = (h ^ s[i]) * 0x100000001b3;
+    return h;
+}
+
+// the parts of this build by name, in part::index order. a snapshot of
+// other parts would put values on the wrong ones.
+std::uint64_t parts_key()
+{
+    static const std::uint64_t ret = [] {
+        const auto n = (std::uint32_t)part::all_parts().size();
+        std::uint64_t h = hash(&n, sizeof(n));
+        for (unsigned i = 0; i < n; i++)
+            h = hash(part::at(i).name, strlen(part::at(i).name) + 1, h);
+        return h;
+    }();
+    return ret;
+}
+
+std::size_t align8(std::size_t x) { return (x + 7) & ~std::size_t{7}; }
+
+} // namespace
+
+const part_catalog& part_catalog::builtin()
+{
+    static const part_catalog ret{[] {
+        std::vector<part_values> values;
+        for (unsigned i = 0; i < part::all_parts().size(); i++)
+        {
+            const part& x = part::at(i);
+            values.push_back({ x.mass, x.power, x.fuel, x.thrust, x.price, x.ammo, x.size_, 0, 0 });
+        }
+        return image(std::move(values));
+    }()};
+    return ret;
+}
+
+std::vector<unsigned char> part_catalog::image(std::vector<part_values> values)
+{
+    const auto n = (std::uint32_t)part::all_parts().size();
+    ASSERT(values.size() == n);
+    std::uint32_t num_slots = 1;
+    while (num_slots < 2 * n)
+        num_slots *= 2;
+
+    std::vector<char> names;
+    std::vector<std::uint16_t> slots(num_slots);
+    for (std::uint32_t i = 0; i < n; i++)
+    {
+        const part& x = part::at(i);
+        const std::size_t len = strlen(x.name);
+        values[i].name = (std::uint32_t)names.size();
+        names.insert(names.end(), x.name, x.name + len + 1);
+        values[i].hull = part::find_hull(x).index;
+        std::uint64_t slot = hash(x.name, len);
+        while (slots[slot & (num_slots - 1)])
+            slot++;
+        slots[slot & (num_slots - 1)] = (std::uint16_t)(i + 1);
+    }
+
+    snapshot_header h = {};
+    memcpy(h.magic, magic, sizeof(magic));
+    h.byte_order = byte_order;
+    h.parts_key = parts_key();
+    h.num_parts = n;
+    h.num_slots = num_slots;
+    h.values_at = (std::uint32_t)align8(sizeof(h));
+    h.slots_at = (std::uint32_t)align8(h.values_at + n * sizeof(part_values));
+    h.names_at = h.slots_at + num_slots * (std::uint32_t)sizeof(std::uint16_t);
+    h.size = h.names_at + (std::uint32_t)names.size();
+
+    std::vector<unsigned char> ret(h.size);
+    memcpy(&ret[h.values_at], values.data(), n * sizeof(part_values));
+    memcpy(&ret[h.slots_at], slots.data(), num_slots * sizeof(std::uint16_t));
+    memcpy(&ret[h.names_at], names.data(), names.size());
+    h.checksum = hash(&ret[sizeof(h)], h.size - sizeof(h));
+    memcpy(ret.data(), &h, sizeof(h));
+    return ret;
+}
+
+part_catalog::part_catalog(std::vector<unsigned char> image) : storage{std::move(image)}
+{
+    if (const char* error = check(storage.size()))
+        ABORT("bad catalog image: %s", error);
+}
+
+part_catalog::part_catalog(const char* path)
+{
+#ifndef _WIN32
+    const int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st))
+    {
+        ERR("%s: %s", path, strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        terminate(EX_NOINPUT);
+    }
+    mapping_size = (std::size_t)st.st_size;
+    mapping = mapping_size ? mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        mapping = nullptr;
+        ERR("%s: %s", path, strerror(errno));
+        terminate(EX_IOERR);
+    }
+    const std::size_t size = mapping_size;
+#else
+    FILE* f = fopen(path, "rb");
+    if (!f)
+    {
+        ERR("%s: %s", path, strerror(errno));
+        terminate(EX_NOINPUT);
+    }
+    unsigned char buf[4096];
+    for (std::size_t n; (n = fread(buf, 1, sizeof(buf), f)) > 0; )
+        storage.insert(storage.end(), buf, buf + n);
+    fclose(f);
+    const std::size_t size = storage.size();
+#endif
+    if (const char* error = check(size))
+    {
+        ERR("%s: %s", path, error);
+        terminate(EX_DATAERR);
+    }
+}
+
+part_catalog::~part_catalog()
+{
+#ifndef _WIN32
+    if (mapping)
+        munmap(mapping, mapping_size);
+#endif
+}
+
+// nullptr if the snapshot can be used as it is
+const char* part_catalog::check(std::size_t size)
+{
+    const auto* data = mapping ? (const unsigned char*)mapping : storage.data();
+    snapshot_header h;
+    if (size < sizeof(h) || memcmp(data, magic, sizeof(magic)))
+        return "not a part catalog snapshot";
+    memcpy(&h, data, sizeof(h));
+    if (h.byte_order != byte_order)
+        return "written on a machine of different byte order";
+    if (h.parts_key != parts_key() || h.num_parts != part::all_parts().size())
+        return "made for other parts, compile it again with this build's hf-design-catalog";
+    if (h.size != size || h.num_slots < h.num_parts || (h.num_slots & (h.num_slots - 1)) ||
+        h.values_at % 8 || h.slots_at % 2 || h.values_at < sizeof(h) ||
+        h.values_at + (std::uint64_t)h.num_parts * sizeof(part_values) > h.slots_at ||
+        h.slots_at + (std::uint64_t)h.num_slots * sizeof(std::uint16_t) > h.names_at || h.names_at > size ||
+        hash(data + sizeof(h), size - sizeof(h)) != h.checksum)
+        return "corrupt snapshot";
+    values = (const part_values*)(data + h.values_at);
+    slots = (const std::uint16_t*)(data + h.slots_at);
+    num_slots = h.num_slots;
+    names = (const char*)(data + h.names_at);
+    hulls.resize(h.num_parts);
+    for (std::uint32_t i = 0; i < h.num_parts; i++)
+    {
+        if (values[i].hull >= h.num_parts || values[i].name >= size - h.names_at)
+            return "corrupt snapshot";
+        hulls[i] = &part::at(values[i].hull);
+    }
+    return nullptr;
+}
+
+const part& part_catalog::find(const char* name, std::size_t len) const
+{
+    for (std::uint64_t slot = hash(name, len); ; slot++)
+    {
+        const std::uint16_t i = slots[slot & (num_slots - 1)];
+        if (!i)
+            return null_part;
+        const char* s = names + values[i - 1].name;
+        if (!strncmp(s, name, len) && !s[len])
+            return part::at(i - 1u);
+    }
+}
+
+} // namespace hf::design
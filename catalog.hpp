@@ -0,0 +1,61 @@
+#pragma once
+#include "part.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace hf::design {
+
+// what a balance patch may change of a part. its size and whether it's a
+// gun stay as built, the search is laid out by them.
+struct part_values final
+{
+    float mass, power, fuel, thrust;
+    std::int32_t price, ammo, size;
+    std::uint32_t hull;     // part::index of the hull it comes with
+    std::uint32_t name;     // offset of its name in the catalog
+};
+
+// the values of every part by part::index, a hash index of their names
+// and each one's hull, in one block laid out as hf-design-catalog writes
+// it to a snapshot: loading one maps the file and checks its header, the
+// values are used where they lie. ships and queries point at theirs and
+// nothing picks one for all, so any number can be in use at once.
+struct part_catalog final
+{
+    static constexpr char magic[8] = { 'h', 'f', 'c', 'a', 't', '\0', '\0', '\1' };
+
+    // the values compiled in from part-list.hpp
+    static const part_catalog& builtin();
+
+    // a snapshot of these values, by part::index. the hulls and names are
+    // filled in.
+    static std::vector<unsigned char> image(std::vector<part_values> values);
+
+    explicit part_catalog(std::vector<unsigned char> image);
+    // exits with an error if the file isn't a snapshot made for the parts
+    // of this build
+    explicit part_catalog(const char* path);
+    ~part_catalog();
+    part_catalog(const part_catalog&) = delete;
+    part_catalog& operator=(const part_catalog&) = delete;
+
+    const part_values& operator[](const part& x) const { return values[x.index]; }
+    const part& hull_of(const part& x) const { return *hulls[x.index]; }
+    // by the name index, null_part if there's no such part
+    const part& find(const char* name, std::size_t len) const;
+
+private:
+    const char* check(std::size_t size);
+
+    std::vector<unsigned char> storage; // unless the file is mapped
+    void* mapping = nullptr;
+    std::size_t mapping_size = 0;
+    const part_values* values = nullptr;
+    const std::uint16_t* slots = nullptr; // part::index + 1, 0 for none
+    std::uint32_t num_slots = 0;
+    const char* names = nullptr;
+    std::vector<const part*> hulls; // of the values' hull indices
+};
+
+} // namespace hf::design
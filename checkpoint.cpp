@@ -0,0 +1,135 @@
+#include "checkpoint.hpp"
+#include "cmdline.hpp"
+#include "defs.hpp"
+#include "log.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+#ifdef _WIN32
+#   include <io.h>
+#else
+#   include <unistd.h>
+#endif
+
+namespace hf::design {
+
+namespace {
+
+constexpr const char* magic = "hf-design checkpoint 1";
+
+volatile std::sig_atomic_t caught = 0;
+
+extern "C" void on_signal(int sig)
+{
+    caught = sig;
+    std::signal(sig, SIG_DFL);
+}
+
+} // namespace
+
+checkpoint::checkpoint(const cmdline& params) :
+    params{params},
+    path{params.checkpoint},
+    next{clock::now() + std::chrono::seconds(params.checkpoint_secs)}
+{
+}
+
+bool checkpoint::load()
+{
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f)
+    {
+        if (errno == ENOENT)
+            return false;
+        ERR("%s: %s", path.c_str(), strerror(errno));
+        terminate(EX_NOINPUT);
+    }
+
+    char buf[4096];
+    unsigned long long query = 0, cursor = 0;
+    int shard = -1, num_shards = -1, designs = -1;
+    bool ok = fgets(buf, sizeof(buf), f) && !strncmp(buf, magic, strlen(magic));
+    while (ok && fgets(buf, sizeof(buf), f))
+    {
+        buf[strcspn(buf, "\r\n")] = '\0';
+        const char* value = strchr(buf, ' ');
+        if (!value)
+            ok = false;
+        else if (!strncmp(buf, "query ", 6))
+            ok = sscanf(value, "%llx", &query) == 1;
+        else if (!strncmp(buf, "shard ", 6))
+            ok = sscanf(value, "%d/%d", &shard, &num_shards) == 2;
+        else if (!strncmp(buf, "cursor ", 7))
+            ok = sscanf(value, "%llu", &cursor) == 1;
+        else if (!strncmp(buf, "designs ", 8))
+            ok = sscanf(value, "%d", &designs) == 1;
+    }
+    fclose(f);
+
+    if (!ok || designs < 0 || num_shards < 0)
+    {
+        ERR("%s: not a checkpoint", path.c_str());
+        terminate(EX_DATAERR);
+    }
+    if (query != params.query || shard != params.shard || num_shards != params.num_shards)
+    {
+        ERR("%s: checkpoint of a different search", path.c_str());
+        terminate(EX_USAGE);
+    }
+    this->cursor = cursor;
+    num_designs = designs;
+    return true;
+}
+
+// written next to the old one and renamed over it, so a crash leaves
+// either of them whole
+void checkpoint::save()
+{
+    const std::string tmp = path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "w");
+    if (!f)
+    {
+        ERR("%s: %s", tmp.c_str(), strerror(errno));
+        terminate(EX_CANTCREAT);
+    }
+    fprintf(f, "%s\n", magic);
+    fprintf(f, "query %016llx\n", (unsigned long long)params.query);
+    fprintf(f, "shard %d/%d\n", params.shard, params.num_shards);
+    fprintf(f, "cursor %llu\n", (unsigned long long)cursor);
+    fprintf(f, "designs %d\n", num_designs);
+
+    bool ok = fflush(f) == 0;
+#ifdef _WIN32
+    ok = ok && _commit(_fileno(f)) == 0;
+#else
+    ok = ok && fsync(fileno(f)) == 0;
+#endif
+    ok = (fclose(f) == 0) && ok;
+    std::error_code ec;
+    if (ok)
+        std::filesystem::rename(tmp, path, ec);
+    if (!ok || ec)
+    {
+        ERR("%s: %s", path.c_str(), ec ? ec.message().c_str() : strerror(errno));
+        terminate(EX_IOERR);
+    }
+    next = clock::now() + std::chrono::seconds(params.checkpoint_secs);
+}
+
+void checkpoint::catch_signals()
+{
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+}
+
+int checkpoint::caught_signal()
+{
+    return caught;
+}
+
+} // namespace hf::design
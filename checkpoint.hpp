@@ -0,0 +1,39 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace hf::design {
+
+struct cmdline;
+
+// where a search got to, saved to --checkpoint every so often and when
+// interrupted. a text file of '<key> <value>' lines, readers skip keys
+// they don't know. designs reported after the last save are reported again on resume.
+struct checkpoint final
+{
+    using clock = std::chrono::steady_clock;
+
+    std::uint64_t cursor = 0;   // first candidate not searched yet, a seq
+    int num_designs = 0;        // reported so far, for -n
+
+    explicit checkpoint(const cmdline& params);
+
+    // false if there's nothing to resume from
+    bool load();
+    void save();
+    // time for another save, or a signal came
+    bool due() const { return caught_signal() || clock::now() >= next; }
+
+    // SIGINT and SIGTERM stop the search at the next due() check. a second
+    // one kills the program.
+    static void catch_signals();
+    static int caught_signal();
+
+private:
+    const cmdline& params;
+    std::string path;
+    clock::time_point next;
+};
+
+} // namespace hf::design
@@ -0,0 +1,75 @@
+# --layout filters designs only once they're packed, so a query with an
+# upper bound on -T or -H must find the designs of the query without it
+# that are below the bound. run by ctest, see CMakeLists.txt.
+
+if(NOT EXE)
+    message(FATAL_ERROR "usage: cmake -DEXE=<hf-design> -P layout-check.cmake")
+endif()
+
+# the budget is for packing to finish, a cut short one depends on timing
+set(common "-F csv -n 65536 --no-atlas --layout --layout-budget 1000000 -a 1")
+# the bounded query, the same without the bound, the csv column and the bound
+set(checks
+    "-T 4:5.5 2:130mm|-T 4 2:130mm|TWR|5.5"
+    "-H 3:4 4:57mm|-H 3 4:57mm|hTWR|4"
+)
+
+function(run args out)
+    separate_arguments(argv UNIX_COMMAND "${common} ${args}")
+    execute_process(COMMAND "${EXE}" ${argv}
+                    OUTPUT_VARIABLE text ERROR_QUIET
+                    RESULT_VARIABLE status)
+    if(NOT status EQUAL 0)
+        message(FATAL_ERROR "layout-check: '${args}' failed with '${status}'")
+    endif()
+    string(REGEX REPLACE "\n$" "" text "${text}")
+    string(REPLACE "\n" ";" text "${text}")
+    set(${out} "${text}" PARENT_SCOPE)
+endfunction()
+
+# the rows of 'lines' whose 'column' is below 'bound', or at it. the csv
+# is rounded, so a row printed at the bound may be on either side of it.
+function(split lines column bound below at)
+    list(GET lines 0 header)
+    string(REPLACE "," ";" header "${header}")
+    list(FIND header "${column}" k)
+    set(ret_below "")
+    set(ret_at "")
+    list(SUBLIST lines 1 -1 rows)
+    foreach(row IN LISTS rows)
+        string(REPLACE "," ";" fields "${row}")
+        list(GET fields ${k} x)
+        if(x LESS bound)
+            list(APPEND ret_below "${row}")
+        elseif(x EQUAL bound)
+            list(APPEND ret_at "${row}")
+        endif()
+    endforeach()
+    set(${below} "${ret_below}" PARENT_SCOPE)
+    set(${at} "${ret_at}" PARENT_SCOPE)
+endfunction()
+
+foreach(check IN LISTS checks)
+    string(REPLACE "|" ";" check "${check}")
+    list(GET check 0 bounded)
+    list(GET check 1 open)
+    list(GET check 2 column)
+    list(GET check 3 bound)
+    run("${bounded}" found)
+    run("${open}" all)
+    split("${all}" ${column} ${bound} want maybe)
+    split("${found}" ${column} ${bound} got got_at)
+    foreach(row IN LISTS got_at)
+        list(FIND maybe "${row}" i)
+        if(i LESS 0)
+            message(FATAL_ERROR "layout-check: '${bounded}' found a design '${open}' didn't: ${row}")
+        endif()
+    endforeach()
+    if(NOT got STREQUAL want)
+        list(LENGTH got n)
+        list(LENGTH want m)
+        message(FATAL_ERROR "layout-check: '${bounded}' found ${n} designs below the bound, '${open}' ${m}")
+    endif()
+    list(LENGTH want n)
+    message(STATUS "layout-check: '${bounded}' ok, ${n} designs")
+endforeach()
@@ -0,0 +1,40 @@
+# runs an instrumented hf-design over the benchmark scenarios.
+# invoked by the 'pgo-train' target, see HF_DESIGN_PGO in CMakeLists.txt.
+
+if(NOT EXE OR NOT PGO_DIR)
+    message(FATAL_ERROR "usage: cmake -DEXE=<hf-design> -DPGO_DIR=<dir> -P pgo-train.cmake")
+endif()
+
+# keep these close to what people actually run. each line is one query.
+set(scenarios
+    "-F csv -bx2 -T 4.5 -e 4:16 -f 4:6 -t 200 -P 0.99 -a 1.3 4:130mm"
+    "-B -n 60000 2:130mm"
+    "-B -F csv -T 3 -c :150000 -u :900 -H 2 -E odd -m 500 -p 3 -a 0.5 1:185mm 2:37mm"
+    "-b -a 1 -E even -F csv 3:180mm"
+    "-B -T 6 -a 2 4:180mmx2"
+    "-C 2:1,2,0,0 -e 1:24 2:57mm"
+)
+
+foreach(args IN LISTS scenarios)
+    separate_arguments(argv UNIX_COMMAND "${args}")
+    message(STATUS "pgo-train: ${args}")
+    # a query without results exits with 1, that's still a valid run
+    execute_process(COMMAND "${EXE}" ${argv}
+                    OUTPUT_QUIET ERROR_QUIET
+                    RESULT_VARIABLE status)
+    if(NOT status MATCHES "^[01]$")
+        message(FATAL_ERROR "pgo-train: '${args}' failed with '${status}'")
+    endif()
+endforeach()
+
+if(COMPILER_ID MATCHES "Clang")
+    if(NOT LLVM_PROFDATA)
+        message(FATAL_ERROR "llvm-profdata is required to merge clang profiles")
+    endif()
+    file(GLOB raw "${PGO_DIR}/*.profraw")
+    execute_process(COMMAND "${LLVM_PROFDATA}" merge -o "${PGO_DIR}/default.profdata" ${raw}
+                    RESULT_VARIABLE status)
+    if(NOT status EQUAL 0)
+        message(FATAL_ERROR "pgo-train: llvm-profdata failed")
+    endif()
+endif()
@@ -3,12 +3,17 @@
 #include "getopt.h"
 #include "defs.hpp"
 #include "part.hpp"
+#include "filter.hpp"
+#include "metric.hpp"
+#include "output.hpp"
 #include "log.hpp"
 
 #include <cerrno>
+#include <climits>
 #include <cstring>
 #include <cstdlib>
 #include <cstdio>
+#include <cstdint>
 #include <utility>
 #include <tuple>
 
@@ -77,6 +82,33 @@ float cmdline::get_float(float min, float max) const
     return x;
 }
 
+// bytes, with an optional k, M or G
+std::size_t cmdline::get_size(std::size_t min) const
+{
+    if (!optarg)
+        wrong_param();
+    char* end;
+    errno = 0;
+    unsigned long long x = std::strtoull(optarg, &end, 10);
+    if (end == optarg || errno == ERANGE || *optarg == '-')
+        wrong_param();
+    int shift = 0;
+    switch (*end)
+    {
+    case 'k': case 'K': shift = 10; end++; break;
+    case 'm': case 'M': shift = 20; end++; break;
+    case 'g': case 'G': shift = 30; end++; break;
+    }
+    if (*end)
+        wrong_param();
+    if (x > (SIZE_MAX >> shift))
+        wrong_param(" (too large)");
+    x <<= shift;
+    if (x < min)
+        wrong_param(" (too small)");
+    return (std::size_t)x;
+}
+
 void cmdline::usage(const char* argv0)
 {
     constexpr const char* opts[][2] = {
@@ -89,16 +121,46 @@ void cmdline::usage(const char* argv0)
         { "-t <secs>",                  "min combat time"                       },
         { "-c <int>",                   "max cost"                              },
         { "-a <float>",                 "layers of armor assuming square ship"  },
-        { "-x <int>",                   "fire extinguisher amount"              },
+        { "-x <int>[:<int>]",           "fire extinguisher amount"              },
         { "-b",                         "enable large tanks"                    },
         { "-B",                         "enable large engines"                  },
         { "-m <float>",                 "add extra mass"                        },
         { "-p <float>",                 "add extra power requirement"           },
-        { "-P <float>",                 "provide less than 100% power"          },
-        { "-C [<nlegs>:]n1,n2,n3,n4",   "how many chassis parts to use"         },
+        { "-P <float>[:<float>]",       "provide less than 100% power"          },
+        { "-C [<nlegs>:]n1,n2,n3,n4",   "how many chassis parts to use, n or n-m"},
+        { "--where <expr>",             "only keep designs matching expression" },
+        { "--layout[=<w>x<h>]",         "pack parts on a grid, armor the outline"},
+        { "--layout-budget <usecs>",    "time limit for packing one design"     },
+        { "--mission <phase>,...",      "fly this mission, see below"           },
+        { "--duel <enemy>",             "fight this enemy, see below"           },
+        { "--duels <int>",              "duels per design, default 1000"        },
         {},
-        { "-F <pretty|csv>",            "output format"                         },
+        { "-F <pretty|csv|bin>",        "output format"                         },
         { "-n <int>",                   "output limit"                          },
+        { "--columns <column>,...",     "print only these, see below"           },
+        { "--output-buffer <int>",      "designs queued for printing, 0 for none"},
+        { "--shard <i>/<n>",            "search only the i-th of n equal parts" },
+        { "--checkpoint <file>",        "save progress there, resume from it"   },
+        { "--checkpoint-interval <secs>", "time between saves, default 60"      },
+        { "--progress[=<secs>]",        "report progress to stderr, default 5s" },
+        { "--dry-run",                  "only print the search size and a guess"},
+        { "--explain",                  "with no designs, tell how close it got"},
+        { "--summary",                  "print what the designs are like, not them"},
+        { "--sort [-]<metric>,...",     "sort all designs, - for descending"    },
+        { "--sort-memory <bytes>[kMG]", "held in memory for --sort, default 256M"},
+        { "--fleet <ships>",            "put together fleets, see below"        },
+        { "--fleet-cost <int>",         "max cost of a fleet"                   },
+        { "--fleet-mass <tons>",        "max mass of a fleet"                   },
+        { "--fleet-twr <float>",        "min twr of a fleet as a whole"         },
+        { "--anytime <secs>",           "anneal for that long, don't search all"},
+        { "--best-first",               "search the most promising engines first"},
+        { "--eval <file>",              "designs from there, not a search, see below"},
+        { "--catalog <file>",           "part values from there, see below"     },
+        { "--islands <int>",            "--anytime threads, default 4"          },
+        { "--seed <int>",               "--anytime, --duel random seed, default 1"},
+        { "--trace <file.json>",        "write a timeline for chrome://tracing" },
+        { "--perf-counters",            "count cycles, misses of each stage"    },
+        { "--no-atlas",                 "search even if the answer is built in" },
         { "-h, -?",                     "this screen"                           },
         { "-G", "help with gun names"                                           },
         {},
@@ -113,7 +175,46 @@ void cmdline::usage(const char* argv0)
         else
             printf("  %-29s %s\n", x[0], x[1]);
     }
+    printf("\nexpressions take metrics (cost, mass, twr, htwr, combat_time, range, ...)\n"
+           "and part names for their counts, numbers, + - * / %%, comparisons, && || !\n"
+           "%% works on whole numbers; a divisor below 1 fails any comparison.\n");
+    printf("\nmission phases are cruise:<km>, return:<km> and combat:<secs>, each with\n"
+           "an optional @<throttle>. the default is cruise:500,combat:<-t>,return:500.\n"
+           "missions give mission_fuel, mission_time and mission_range.\n");
+    printf("\nthe --duel enemy is count:gun... with armor:<mass>, hull:<mass> and\n"
+           "htwr:<float>, e.g. 2:130mm,armor:1000,hull:300,htwr:3, the defaults but\n"
+           "for the guns. designs that pass the rest fight it --duels times and get a\n"
+           "win_rate, draws counting half. the model is rough: use it to compare.\n");
+    printf("\nranges given to -x, -P (in steps of 0.01) or the leg counts of -C are\n"
+           "searched through, every mix of them on every set of engines.\n");
+    printf("\n--columns takes csv headers, _ for a space, metrics and part names,\n"
+           "e.g. cost,twr,D-30,e_nk25. nothing else is worked out for the output.\n");
+    printf("\n--eval reads csv, a header of part names or hf-design's own and a\n"
+           "design's counts on each line, or -F bin records, - for stdin. the designs\n"
+           "get their metrics, filters and output as found ones would. csv without\n"
+           "hull columns gets the hulls of its parts as the search mounts them, a\n"
+           "bridge, the guns and -C of the command line and -x extinguishers added,\n"
+           "and armor by its mass. -m and -p count for all. parts are added in the\n"
+           "search's order, so its own output reads back as it was found when given\n"
+           "the same options, with several guns if they're listed by name.\n");
+    printf("\n--catalog takes a snapshot made by hf-design-catalog from a list of part\n"
+           "values, for a game version other than the one built in.\n");
+    printf("\nshards are numbered from 0. their csv or bin output is put back together\n"
+           "by hf-design-merge, in the order and up to the -n of a single run.\n");
+    printf("\n--sort with -n prints the first n of all designs in that order. what\n"
+           "doesn't fit in --sort-memory goes to temporary files.\n");
+    printf("\n--fleet takes loadouts separated by /, e.g. 2:130mm / 4:57mm, and picks up\n"
+           "to <ships> of their designs, most guns first, then least cost and mass.\n"
+           "-n is the number of fleets, 1 by default.\n");
+    printf("\n--summary gives the range, mean and quantiles of the metrics, histograms\n"
+           "of cost, mass, twr and combat_time and the engine counts of the designs,\n"
+           "the first -n of them. quantiles and histograms are within 1%%.\n");
+    printf("\n--anytime prints the best -n designs it came across, 1 by default, in\n"
+           "--sort order or else cheapest first. better ones go to stderr as found.\n");
+    printf("\nrunning again with the --checkpoint of an interrupted search picks it up\n"
+           "where it left off; append the output to what the first run printed.\n");
     printf("\nexample: %s -F csv -bx2 -T 4.5 -e 4:16 -f 4:6 -t 200 -P 0.99 -a 1.3 4:130mm\n", argv0);
+    printf("example: %s --where 'range > 1400 && cost/mass < 8 || e_nk25 == 0' 2:130mm\n", argv0);
     fflush(stdout);
     terminate(stdout == stderr ? EX_USAGE : 0);
 }
@@ -130,13 +231,136 @@ void cmdline::gun_list() const
     seek_help();
 }
 
+enum : int {
+    opt_where = 0x100,
+    opt_layout,
+    opt_layout_budget,
+    opt_mission,
+    opt_shard,
+    opt_checkpoint,
+    opt_checkpoint_interval,
+    opt_progress,
+    opt_dry_run,
+    opt_output_buffer,
+    opt_trace,
+    opt_sort,
+    opt_sort_memory,
+    opt_fleet,
+    opt_fleet_cost,
+    opt_fleet_mass,
+    opt_fleet_twr,
+    opt_anytime,
+    opt_islands,
+    opt_seed,
+    opt_explain,
+    opt_summary,
+    opt_duel,
+    opt_duels,
+    opt_no_atlas,
+    opt_perf_counters,
+    opt_best_first,
+    opt_columns,
+    opt_eval,
+    opt_catalog,
+};
+
+// FNV-1a over the arguments that pick designs, so that merging can tell
+// shards of different queries apart, and resuming a different query from
+// a checkpoint fails.
+static std::uint64_t query_hash(int argc, const char* const* argv)
+{
+    constexpr const char* ignored[] = {
+        "--shard", "--checkpoint", "--checkpoint-interval", "--output-buffer", "--trace",
+        "--sort-memory",
+    };
+    constexpr const char* ignored_flags[] = { "--no-atlas", "--perf-counters", "--dry-run" };
+    std::uint64_t h = 0xcbf29ce484222325;
+    for (int i = 1; i < argc; i++)
+    {
+        bool skip = false;
+        for (const char* name : ignored)
+        {
+            std::size_t len = strlen(name);
+            if (!strncmp(argv[i], name, len) && (argv[i][len] == '=' || !argv[i][len]))
+            {
+                i += !argv[i][len];
+                skip = true;
+                break;
+            }
+        }
+        for (const char* name : ignored_flags)
+            skip = skip || !strcmp(argv[i], name);
+        // optional argument, only ever --progress=<secs>
+        skip = skip || !strcmp(argv[i], "--progress") || !strncmp(argv[i], "--progress=", 11);
+        if (skip)
+            continue;
+        for (const char* s = argv[i]; ; s++)
+        {
+            h = (h ^ (unsigned char)*s) * 0x100000001b3;
+            if (!*s)
+                break;
+        }
+    }
+    return h;
+}
+
+static bool sorts_by(const sort_order& sort, metric_info::stage_ stage)
+{
+    for (int i = 0; i < sort.num_keys; i++)
+        if (metric_info_of(sort.keys[i].m).stage == stage)
+            return true;
+    return false;
+}
+
+static bool shows(const column_list& columns, column_section section)
+{
+    for (int i = 0; i < columns.count; i++)
+        if (column_section_of(columns.ids[i]) == section)
+            return true;
+    return false;
+}
+
 cmdline cmdline::parse_options(int argc, const char* const* argv)
 {
+    constexpr musl_option longopts[] = {
+        { "where",          musl_required_argument, nullptr, opt_where          },
+        { "layout",         musl_optional_argument, nullptr, opt_layout         },
+        { "layout-budget",  musl_required_argument, nullptr, opt_layout_budget  },
+        { "mission",        musl_required_argument, nullptr, opt_mission        },
+        { "shard",          musl_required_argument, nullptr, opt_shard          },
+        { "checkpoint",     musl_required_argument, nullptr, opt_checkpoint     },
+        { "checkpoint-interval", musl_required_argument, nullptr, opt_checkpoint_interval },
+        { "progress",       musl_optional_argument, nullptr, opt_progress       },
+        { "dry-run",        musl_no_argument,       nullptr, opt_dry_run        },
+        { "output-buffer",  musl_required_argument, nullptr, opt_output_buffer  },
+        { "trace",          musl_required_argument, nullptr, opt_trace          },
+        { "sort",           musl_required_argument, nullptr, opt_sort           },
+        { "sort-memory",    musl_required_argument, nullptr, opt_sort_memory    },
+        { "fleet",          musl_required_argument, nullptr, opt_fleet          },
+        { "fleet-cost",     musl_required_argument, nullptr, opt_fleet_cost     },
+        { "fleet-mass",     musl_required_argument, nullptr, opt_fleet_mass     },
+        { "fleet-twr",      musl_required_argument, nullptr, opt_fleet_twr      },
+        { "anytime",        musl_required_argument, nullptr, opt_anytime        },
+        { "islands",        musl_required_argument, nullptr, opt_islands        },
+        { "seed",           musl_required_argument, nullptr, opt_seed           },
+        { "explain",        musl_no_argument,       nullptr, opt_explain        },
+        { "summary",        musl_no_argument,       nullptr, opt_summary        },
+        { "duel",           musl_required_argument, nullptr, opt_duel           },
+        { "duels",          musl_required_argument, nullptr, opt_duels          },
+        { "no-atlas",       musl_no_argument,       nullptr, opt_no_atlas       },
+        { "perf-counters",  musl_no_argument,       nullptr, opt_perf_counters  },
+        { "best-first",     musl_no_argument,       nullptr, opt_best_first     },
+        { "columns",        musl_required_argument, nullptr, opt_columns        },
+        { "eval",           musl_required_argument, nullptr, opt_eval           },
+        { "catalog",        musl_required_argument, nullptr, opt_catalog        },
+        { "help",           musl_no_argument,       nullptr, 'h'                },
+        {},
+    };
     int c;
     cmdline p{argc, argv};
     opterr = 1;
 
-    while ((c = musl_getopt(argc, argv, "f:e:E:T:H:u:t:c:hGa:n:x:F:bm:p:BP:C:")) != -1)
+    while ((c = musl_getopt_long(argc, argv, "f:e:E:T:H:u:t:c:hGa:n:x:F:bm:p:BP:C:", longopts, nullptr)) != -1)
         switch (c)
         {
         default:
@@ -163,16 +387,118 @@ cmdline cmdline::parse_options(int argc, const char* const* argv)
         case 'G': p.gun_list(); terminate(0);
         case 'a': p.armor_layers = p.get_float(0, 16); break;
         case 'n': p.num_matches = p.get_int(0); if (!p.num_matches) p.num_matches = INT_MAX; break;
-        case 'x': p.num_extinguishers = p.get_int(0, 255); break;
+        case 'x': p.extinguishers.parse(c, optarg); break;
         case 'F': p.format = p.parse_format(optarg); break;
         case 'b': p.use_big_tanks = true; break;
         case 'm': p.extra_mass += p.get_float(-1e12f, 1e12f); break;
         case 'p': p.extra_power += p.get_float(0, 1e3f); break;
         case 'B': p.use_big_engines = true; p.use_big_tanks = true; break;
-        case 'P': p.power = p.get_float(0, 1); break;
+        case 'P': p.power.parse(c, optarg); break;
         case 'C': p.chassis = p.parse_chassis_layout(optarg); break;
+        case opt_where: p.where = optarg; break;
+        case opt_layout: p.use_layout = true; if (optarg) p.parse_layout_size(optarg); break;
+        case opt_layout_budget: p.layout.budget_usecs = p.get_int(1, 1000000); break;
+        case opt_mission: p.parse_mission(optarg); break;
+        case opt_shard: p.parse_shard(optarg); break;
+        case opt_checkpoint: p.checkpoint = optarg; break;
+        case opt_checkpoint_interval: p.checkpoint_secs = p.get_int(1, INT_MAX); break;
+        case opt_progress: p.progress_secs = optarg ? p.get_int(1, INT_MAX) : 5; break;
+        case opt_dry_run: p.dry_run = true; break;
+        case opt_output_buffer: p.output_depth = p.get_int(0, 1 << 20); break;
+        case opt_trace: p.trace = optarg; break;
+        case opt_sort: p.parse_sort(optarg); break;
+        case opt_sort_memory: p.sort.memory = p.get_size(1 << 20); break;
+        case opt_fleet: p.fleet.ships = p.get_int(1, 64); break;
+        case opt_fleet_cost: p.fleet.cost = p.get_int(0, INT_MAX); break;
+        case opt_fleet_mass: p.fleet.mass = p.get_float(0, 1e9f); break;
+        case opt_fleet_twr: p.fleet.twr = p.get_float(0, 1e3f); break;
+        case opt_anytime: p.anytime.secs = p.get_int(1, INT_MAX); break;
+        case opt_islands: p.anytime.islands = p.get_int(1, 256); break;
+        case opt_seed: p.anytime.seed = (std::uint64_t)p.get_int(0, INT_MAX); break;
+        case opt_explain: p.explain = true; break;
+        case opt_summary: p.summary = true; break;
+        case opt_duel: p.parse_duel(optarg); break;
+        case opt_duels: p.duel.duels = p.get_int(1, 1 << 20); break;
+        case opt_no_atlas: p.use_atlas = false; break;
+        case opt_perf_counters: p.perf_counters = true; break;
+        case opt_best_first: p.best_first = true; break;
+        case opt_columns: p.parse_columns(optarg); break;
+        case opt_eval: p.eval = optarg; break;
+        case opt_catalog: p.catalog_file = optarg; break;
         }
 ok:
+    if (p.extinguishers.min < 0 || p.extinguishers.max > 255)
+    {
+        ERR("-x takes 0 to 255 extinguishers");
+        goto error;
+    }
+    if (p.power.min < .01f || p.power.max > 1)
+    {
+        ERR("-P takes a fraction from 0.01 to 1");
+        goto error;
+    }
+    if (p.sort.enabled() && (p.use_shards || p.checkpoint))
+    {
+        ERR("--sort can't be used with --shard or --checkpoint");
+        goto error;
+    }
+    if (p.fleet.enabled() && (p.sort.enabled() || p.use_shards || p.checkpoint || p.dry_run || p.format != fmt_pretty))
+    {
+        ERR("--fleet can't be used with --sort, --shard, --checkpoint, --dry-run or -F");
+        goto error;
+    }
+    if (p.anytime.enabled() && (p.fleet.enabled() || p.use_shards || p.checkpoint || p.dry_run))
+    {
+        ERR("--anytime can't be used with --fleet, --shard, --checkpoint or --dry-run");
+        goto error;
+    }
+    if (p.explain && (p.fleet.enabled() || p.anytime.enabled() || p.use_shards || p.checkpoint || p.dry_run))
+    {
+        ERR("--explain can't be used with --fleet, --anytime, --shard, --checkpoint or --dry-run");
+        goto error;
+    }
+    if (p.best_first && (p.fleet.enabled() || p.anytime.enabled() || p.use_shards || p.checkpoint ||
+                         p.explain || p.dry_run))
+    {
+        ERR("--best-first can't be used with --fleet, --anytime, --shard, --checkpoint, --explain or --dry-run");
+        goto error;
+    }
+    if (p.summary && (p.sort.enabled() || p.fleet.enabled() || p.anytime.enabled() || p.use_shards ||
+                      p.checkpoint || p.format == fmt_bin))
+    {
+        ERR("--summary can't be used with --sort, --fleet, --anytime, --shard, --checkpoint or -F bin");
+        goto error;
+    }
+    if (p.columns.enabled() && (p.summary || p.fleet.enabled() || p.format == fmt_bin))
+    {
+        ERR("--columns can't be used with --summary, --fleet or -F bin");
+        goto error;
+    }
+    if (!p.use_layout && shows(p.columns, column_section::layout))
+    {
+        ERR("width, height and perimeter need --layout");
+        goto error;
+    }
+    p.query = query_hash(argc, argv);
+    if (p.output_depth < 0)
+        p.output_depth = output_pipe::default_depth();
+    (void)filter::compile(p); // report bad expressions before searching
+    if (!p.duel.enabled && (!filter::compile(p, metric_info::duel).empty() || sorts_by(p.sort, metric_info::duel) ||
+                            shows(p.columns, column_section::duel)))
+    {
+        ERR("win_rate needs --duel");
+        goto error;
+    }
+    if (!p.mission.enabled && (!filter::compile(p, metric_info::mission).empty() || sorts_by(p.sort, metric_info::mission) ||
+                               shows(p.columns, column_section::mission)))
+        p.mission.set_default(p.combat_time);
+    if (p.eval && (p.fleet.enabled() || p.anytime.enabled() || p.best_first || p.use_shards || p.checkpoint ||
+                   p.explain || p.dry_run || p.progress_secs || p.use_layout || p.mission.enabled || p.duel.enabled))
+    {
+        ERR("--eval can't be used with --fleet, --anytime, --best-first, --shard, --checkpoint, --explain, "
+            "--dry-run, --progress, --layout, --mission or --duel");
+        goto error;
+    }
     return p;
 error:
     p.seek_help();
@@ -184,6 +510,7 @@ cmdline::fmt cmdline::parse_format(const char* str) const
     const std::pair<const char*, fmt> formats[] = {
         { "pretty",     fmt_pretty  },
         { "csv",        fmt_csv     },
+        { "bin",        fmt_bin     },
     };
     for (const auto& [name, fmt] : formats)
         if (!strcmp(str, name))
@@ -199,8 +526,8 @@ cmdline::fmt cmdline::parse_format(const char* str) const
 cmdline::chassis_layout cmdline::parse_chassis_layout(const char* str)
 {
     char buf[64];
-    chassis_layout ret = { 0, { 0, 0, 0, 0 } };
-    auto& [nlegs, array] = ret;
+    chassis_layout ret;
+    auto& nlegs = ret.nlegs;
     char* pos;
 
     auto parse = [this](const char* x) {
@@ -241,19 +568,33 @@ cmdline::chassis_layout cmdline::parse_chassis_layout(const char* str)
     else
         pos = buf;
 
-    for (unsigned i = 0; pos && i <= std::size(array); i++)
+    for (unsigned i = 0; pos && i <= std::size(ret.min); i++)
     {
         char* next = strchr(pos, ',');
-        if (i == std::size(array))
+        if (i == std::size(ret.min))
         {
             ERR(BAD_CHASSIS "too many elements in part list");
             goto error;
         }
         if (next)
             *next++ = '\0';
-        array[i] = parse(pos);
+        char* to = strchr(pos, '-'); // a range, n-m
+        if (to)
+            *to++ = '\0';
+        ret.min[i] = parse(pos);
+        ret.max[i] = to ? parse(to) : ret.min[i];
+        if (ret.max[i] < ret.min[i])
+        {
+            ERR(BAD_CHASSIS "empty range in part list");
+            goto error;
+        }
         pos = next;
     }
+    if (nlegs && !ret.enabled())
+    {
+        ERR(BAD_CHASSIS "corner pieces but no legs");
+        goto error;
+    }
 
     return ret;
 error:
@@ -261,6 +602,236 @@ error:
     terminate(EX_USAGE);
 }
 
+void cmdline::parse_layout_size(const char* str)
+{
+    int w, h;
+    char c;
+    if (sscanf(str, "%dx%d%c", &w, &h, &c) != 2)
+        ERR("invalid layout size -- '%s'", str);
+    else if (w < 1 || h < 1 || w > layout_limits::max_size || h > layout_limits::max_size)
+        ERR("layout size must be within 1x1 and %dx%d", layout_limits::max_size, layout_limits::max_size);
+    else
+    {
+        layout.max_width = w;
+        layout.max_height = h;
+        return;
+    }
+    seek_help();
+    terminate(EX_USAGE);
+}
+
+void cmdline::parse_mission(const char* str)
+{
+    constexpr std::tuple<const char*, mission_phase::kind_, float> kinds[] = {
+        { "cruise", mission_phase::cruise, mission_profile::cruise_throttle },
+        { "return", mission_phase::cruise, mission_profile::cruise_throttle },
+        { "combat", mission_phase::combat, 1                                },
+    };
+    mission = {};
+
+    for (const char* pos = str; *pos; )
+    {
+        const char* end = pos + strcspn(pos, ",");
+        const char* sep = strchr(pos, ':');
+        if (!sep || sep > end)
+        {
+            ERR("invalid mission phase -- '%.*s'", (int)(end - pos), pos);
+            goto error;
+        }
+        if (mission.num_phases == mission_profile::max_phases)
+        {
+            ERR("too many mission phases, at most %d", mission_profile::max_phases);
+            goto error;
+        }
+        {
+            auto& x = mission.phases[mission.num_phases];
+            bool found = false;
+            for (const auto& [name, kind, throttle] : kinds)
+                if (strlen(name) == (std::size_t)(sep - pos) && !strncmp(name, pos, (std::size_t)(sep - pos)))
+                {
+                    x = { kind, 0, throttle };
+                    found = true;
+                }
+            char* endptr;
+            errno = 0;
+            if (found)
+                x.amount = string_to_type<float>(sep + 1, &endptr);
+            if (!found || errno || endptr == sep + 1 || x.amount < 0 || (*endptr && *endptr != '@' && *endptr != ','))
+            {
+                ERR("invalid mission phase -- '%.*s'", (int)(end - pos), pos);
+                goto error;
+            }
+            if (*endptr == '@')
+            {
+                const char* t = endptr + 1;
+                x.throttle = string_to_type<float>(t, &endptr);
+                if (errno || endptr == t || endptr != end || !(x.throttle > 0 && x.throttle <= 1))
+                {
+                    ERR("invalid throttle in mission phase -- '%.*s'", (int)(end - pos), pos);
+                    goto error;
+                }
+            }
+        }
+        mission.num_phases++;
+        pos = *end ? end + 1 : end;
+    }
+    if (!mission.num_phases)
+    {
+        ERR("empty mission");
+        goto error;
+    }
+    mission.enabled = true;
+    return;
+error:
+    seek_help();
+    terminate(EX_USAGE);
+}
+
+void cmdline::parse_duel(const char* str)
+{
+    const std::pair<const char*, float*> attrs[] = {
+        { "armor",  &duel.armor },
+        { "hull",   &duel.hull  },
+        { "htwr",   &duel.htwr  },
+    };
+    duel.num_guns = 0;
+
+    for (const char* pos = str; *pos; )
+    {
+        const char* end = pos + strcspn(pos, ",");
+        const char* sep = strchr(pos, ':');
+        const int len = (int)(end - pos);
+        if (!sep || sep > end || sep + 1 == end)
+        {
+            ERR("invalid duel enemy -- '%.*s'", len, pos);
+            goto error;
+        }
+        if (*pos >= '0' && *pos <= '9')
+        {
+            char name[64] = "g_", *endptr;
+            errno = 0;
+            const long count = strtol(pos, &endptr, 10);
+            if (errno || endptr != sep || count < 1 || count > 64 || end - sep - 1 >= (long)sizeof(name) - 2)
+            {
+                ERR("invalid duel gun -- '%.*s'", len, pos);
+                goto error;
+            }
+            memcpy(name + 2, sep + 1, (std::size_t)(end - sep - 1));
+            name[2 + (end - sep - 1)] = '\0';
+            const auto& x = part::find_part(name);
+            if (x.ammo >= 0)
+            {
+                ERR("no such gun -- '%s'", name + 2);
+                goto error;
+            }
+            if (duel.num_guns == duel_options::max_guns)
+            {
+                ERR("too many duel guns, at most %d", duel_options::max_guns);
+                goto error;
+            }
+            duel.guns[duel.num_guns++] = { &x, (int)count };
+        }
+        else
+        {
+            float* value = nullptr;
+            for (const auto& [name, x] : attrs)
+                if (strlen(name) == (std::size_t)(sep - pos) && !strncmp(name, pos, (std::size_t)(sep - pos)))
+                    value = x;
+            char* endptr;
+            errno = 0;
+            const float x = value ? string_to_type<float>(sep + 1, &endptr) : 0;
+            if (!value || errno || endptr != end || !(x >= 0 && x < 1e9f))
+            {
+                ERR("invalid duel enemy -- '%.*s'", len, pos);
+                goto error;
+            }
+            *value = x;
+        }
+        pos = *end ? end + 1 : end;
+    }
+    if (!duel.num_guns)
+    {
+        ERR("the duel enemy needs a gun");
+        goto error;
+    }
+    duel.enabled = true;
+    return;
+error:
+    seek_help();
+    terminate(EX_USAGE);
+}
+
+void cmdline::parse_shard(const char* str)
+{
+    int i, n;
+    char c;
+    if (sscanf(str, "%d/%d%c", &i, &n, &c) != 2 || n < 1 || i < 0 || i >= n)
+    {
+        ERR("invalid shard, expected <i>/<n> with 0 <= i < n -- '%s'", str);
+        seek_help();
+        terminate(EX_USAGE);
+    }
+    shard = i;
+    num_shards = n;
+    use_shards = true;
+}
+
+void cmdline::parse_sort(const char* str)
+{
+    sort.num_keys = 0;
+    for (const char* pos = str; ; )
+    {
+        const char* end = pos + strcspn(pos, ",");
+        const bool descending = *pos == '-';
+        const char* name = pos + descending;
+        const metric_info* m = find_metric(name, (std::size_t)(end - name));
+        if (!m)
+        {
+            ERR("invalid sort key, expected a metric -- '%.*s'", (int)(end - pos), pos);
+            goto error;
+        }
+        if (sort.num_keys == sort_order::max_keys)
+        {
+            ERR("too many sort keys, at most %d", sort_order::max_keys);
+            goto error;
+        }
+        sort.keys[sort.num_keys++] = { m->id, descending };
+        if (!*end)
+            return;
+        pos = end + 1;
+    }
+error:
+    seek_help();
+    terminate(EX_USAGE);
+}
+
+void cmdline::parse_columns(const char* str)
+{
+    columns.count = 0;
+    for (const char* pos = str; ; )
+    {
+        const char* end = pos + strcspn(pos, ",");
+        short id;
+        if (!find_column(pos, (std::size_t)(end - pos), id))
+        {
+            ERR("invalid column, expected a csv header, metric or part -- '%.*s'", (int)(end - pos), pos);
+            goto error;
+        }
+        if (columns.count == column_list::max_columns)
+        {
+            ERR("too many columns, at most %d", column_list::max_columns);
+            goto error;
+        }
+        columns.ids[columns.count++] = id;
+        if (!*end)
+            return;
+        pos = end + 1;
+    }
+error:
+    seek_help();
+    terminate(EX_USAGE);
+}
+
 cmdline::parity cmdline::parse_parity(const char* str)
 {
     constexpr std::tuple<const char*, parity> args[] = {
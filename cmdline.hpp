@@ -1,6 +1,15 @@
 #pragma once
 #include "interval.hpp"
+#include "layout.hpp"
+#include "mission.hpp"
+#include "duel.hpp"
+#include "sort.hpp"
+#include "fleet.hpp"
+#include "anytime.hpp"
+#include "report.hpp"
+#include "catalog.hpp"
 #include <limits>
+#include <cstdint>
 #include <array>
 #include <tuple>
 
@@ -14,6 +23,7 @@ struct cmdline final
     enum fmt : char {
         fmt_pretty = 1,
         fmt_csv,
+        fmt_bin,
         fmt_default = fmt_pretty
     };
 
@@ -26,7 +36,15 @@ struct cmdline final
     static constexpr auto int_min = std::numeric_limits<int>::min();
     static constexpr auto int_max = std::numeric_limits<int>::max();
 
-    using chassis_layout = std::tuple<int, std::array<int, 4>>;
+    // -C: corner pieces, and how many of leg1 to leg4 as ranges. with
+    // none of them the legs go by the fixed thrusters.
+    struct chassis_layout final
+    {
+        int nlegs = 0;
+        std::array<int, 4> min{}, max{};
+
+        constexpr bool enabled() const { return max[0] + max[1] + max[2] + max[3] > 0; }
+    };
 
     finterval twr{1.1f, float_max};
     finterval horizontal_twr{0, float_max};
@@ -35,20 +53,46 @@ struct cmdline final
     int combat_time = 200;
     iinterval cost{0, int_max, interval_behavior::max};
     iinterval fixed_engines{2, 6, interval_behavior::equal};
-    float power = 1;
-    chassis_layout chassis = {0, { 0, 0, 0, 0} };
+    finterval power{1, 1, interval_behavior::equal};
+    chassis_layout chassis;
 
     float armor_layers = 0;
     float extra_mass = 0;
     float extra_power = 0;
+    const char* where = nullptr;
+    const char* checkpoint = nullptr;
+    const char* eval = nullptr; // file of designs, - for stdin
+    const char* catalog_file = nullptr;
+    const part_catalog* catalog = &part_catalog::builtin(); // loaded from catalog_file by the caller
+    int checkpoint_secs = 60;
+    const char* trace = nullptr;
+    int progress_secs = 0;
+    int output_depth = -1; // designs buffered for the writer thread, -1 for the default
+    layout_limits layout;
+    mission_profile mission;
+    duel_options duel;
+    sort_order sort;
+    column_list columns;
+    fleet_limits fleet;
+    anytime_options anytime;
     const char* const* argv = nullptr;
     int argc = 0;
+    int shard = 0, num_shards = 1;
+    std::uint64_t query = 0; // hash of the arguments, less --shard and --checkpoint
     int num_matches = std::numeric_limits<int>::max();
-    int num_extinguishers = 2;
+    iinterval extinguishers{2, 2, interval_behavior::equal};
     fmt format = fmt_default;
     parity engine_parity = parity::any;
     bool use_big_tanks = false;
     bool use_big_engines = false;
+    bool use_layout = false;
+    bool use_shards = false;
+    bool dry_run = false;
+    bool explain = false;
+    bool summary = false;
+    bool use_atlas = true;
+    bool perf_counters = false;
+    bool best_first = false;
 
     static cmdline parse_options(int argc, const char* const* argv);
     [[noreturn]] void wrong_param(const char* explain = "") const;
@@ -62,6 +106,13 @@ struct cmdline final
     static void synopsis(const char* argv0);
     [[noreturn]] static void usage(const char* argv0);
     chassis_layout parse_chassis_layout(const char* str);
+    void parse_layout_size(const char* str);
+    void parse_mission(const char* str);
+    void parse_duel(const char* str);
+    void parse_shard(const char* str);
+    void parse_sort(const char* str);
+    void parse_columns(const char* str);
+    std::size_t get_size(std::size_t min) const;
 
 private:
     cmdline() = default;
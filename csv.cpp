@@ -1,20 +1,28 @@
+#include "report.hpp"
+#include "metric.hpp"
 #include "part-list.hpp"
 #include "ship.hpp"
+#include <cctype>
 #include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <optional>
+#include <string>
 #include <variant>
-#include <numeric>
+#include <tuple>
 
 namespace hf::design {
 
 struct line final
 {
-    explicit line(FILE* stream) : stream{stream} {}
+    explicit line(FILE* stream, char separator = ',') : stream{stream}, separator{separator} {}
     void sep();
     template<typename T> line& operator<<(T);
+    template<typename T> void write(T x);
 
 private:
-    template<typename T> void write(T x);
     FILE* stream;
+    char separator;
     bool first_column = true;
 };
 
@@ -23,7 +31,7 @@ template<typename T> line& line::operator<<(T x) { sep(); write(x); return *this
 void line::sep()
 {
     if (!first_column)
-        putc(',', stream);
+        putc(separator, stream);
     first_column = false;
 }
 
@@ -32,58 +40,199 @@ using float_format = std::tuple<float, int>;
 template<> void line::write(float x) { fprintf(stream, "%.1f", (double)x); }
 template<> void line::write(float_format x) { auto [f, p] = x; fprintf(stream, "%.*f", p, (double)f); }
 template<> void line::write(int x) { fprintf(stream, "%d", x); }
+template<> void line::write(unsigned long long x) { fprintf(stream, "%llu", x); }
 template<> void line::write(char x) { putc(x, stream); }
 template<> void line::write(const char* x) { fprintf(stream, "%s", x); }
 
-bool report_csv(const ship& st, int k)
+namespace {
+
+using variant = std::variant<int, float, float_format>;
+
+struct column final
+{
+    const char* name;
+    std::optional<metric> m; // the metric it shows, so it goes by that name too
+    variant (*value)(const ship& st);
+    column_section section = column_section::base;
+    const part* counts = nullptr; // the part it's the count of
+};
+
+template<const part& x> variant count_of(const ship& st) { return st.count(x); }
+template<const part& x> constexpr column count_column(const char* name) { return { name, {}, count_of<x>, column_section::base, &x }; }
+
+const column columns[] = {
+    { "Cost",           metric::cost,           [](const ship& st) -> variant { return st.cost; }                           },
+    { "Mass",           metric::mass,           [](const ship& st) -> variant { return st.mass; }                           },
+    { "TWR",            metric::twr,            [](const ship& st) -> variant { return float_format{st.twr(), 2}; }         },
+    { "hTWR",           metric::horizontal_twr, [](const ship& st) -> variant { return float_format{st.horizontal_twr(), 2}; } },
+    { "Combat time",    metric::combat_time,    [](const ship& st) -> variant { return st.combat_time(); }                  },
+    { "Speed",          metric::speed,          [](const ship& st) -> variant { return st.speed(); }                        },
+    { "Range",          metric::range,          [](const ship& st) -> variant { return st.range(); }                        },
+    { "Fuel usage",     metric::fuel_usage,     [](const ship& st) -> variant { return st.fuel_usage(); }                   },
+    { "Armor",          {},                     [](const ship& st) -> variant { return st.count(arm_1x1) * (*st.catalog)[arm_1x1].mass; }  },
+    { "Fuel",           metric::fuel,           [](const ship& st) -> variant { return (int)st.fuel; }                      },
+    //{ "Tanks (tons)",   mass_of(tank_1x2) + mass_of(tank_4x4)   },
+    count_column<e_d30s>("D-30s"),
+    count_column<e_d30>("D-30"),
+    count_column<e_nk25>("NK-25"),
+    count_column<e_rd51>("RD-51"),
+    count_column<e_rd59>("RD-59"),
+    count_column<tank_4x4>("Tank L"),
+    count_column<tank_1x2>("Tank S"),
+    count_column<pwr_1x2>("Power S"),
+    count_column<pwr_2x2>("Power L"),
+    count_column<leg1>("Leg(1)"),
+    count_column<leg2>("Leg(2)"),
+    count_column<leg3>("Leg(3)"),
+    count_column<leg4>("Leg(4)"),
+
+    // only present with --layout
+    { "Width",          metric::width,          [](const ship& st) -> variant { return (int)st.width; },        column_section::layout  },
+    { "Height",         metric::height,         [](const ship& st) -> variant { return (int)st.height; },       column_section::layout  },
+    { "Perimeter",      metric::perimeter,      [](const ship& st) -> variant { return (int)st.perimeter; },    column_section::layout  },
+    // only present with --mission
+    { "Mission fuel",   metric::mission_fuel,   [](const ship& st) -> variant { return st.mission.fuel; },      column_section::mission },
+    { "Mission time",   metric::mission_time,   [](const ship& st) -> variant { return st.mission.time; },      column_section::mission },
+    { "Mission range",  metric::mission_range,  [](const ship& st) -> variant { return st.mission.range; },     column_section::mission },
+    // --duel
+    { "Win rate",       metric::win_rate,       [](const ship& st) -> variant { return float_format{st.duel.win_rate, 3}; }, column_section::duel },
+
+    // only asked for by --columns
+    { "Power",          metric::power,          [](const ship& st) -> variant { return st.power; },             column_section::extra   },
+    { "Area",           metric::area,           [](const ship& st) -> variant { return st.area; },              column_section::extra   },
+    { "Fuel flow",      metric::fuel_flow,      [](const ship& st) -> variant { return st.fuel_flow; },         column_section::extra   },
+    { "Thrust",         metric::thrust,         [](const ship& st) -> variant { return st.thrust; },            column_section::extra   },
+    { "hThrust",        metric::horizontal_thrust, [](const ship& st) -> variant { return st.horizontal_thrust; }, column_section::extra },
+};
+
+// a header in any case, _ for a space
+bool same_name(const char* header, const char* name, std::size_t len)
+{
+    std::size_t i = 0;
+    for (; i < len && header[i]; i++)
+        if (std::tolower((unsigned char)header[i]) != std::tolower((unsigned char)name[i]) &&
+            !(header[i] == ' ' && name[i] == '_'))
+            return false;
+    return i == len && !header[i];
+}
+
+const char* column_name(short id)
+{
+    return id >= 0 ? columns[id].name : part::all_parts()[(std::size_t)(-1 - id)]->name;
+}
+
+variant column_value(const ship& st, short id)
+{
+    return id >= 0 ? columns[id].value(st) : variant{st.count(*part::all_parts()[(std::size_t)(-1 - id)])};
+}
+
+} // namespace
+
+bool find_column(const char* name, std::size_t len, short& id)
+{
+    for (std::size_t i = 0; i < std::size(columns); i++)
+        if (same_name(columns[i].name, name, len))
+            return id = (short)i, true;
+    if (const metric_info* m = find_metric(name, len))
+        for (std::size_t i = 0; i < std::size(columns); i++)
+            if (columns[i].m == m->id)
+                return id = (short)i, true;
+    const auto& parts = part::all_parts();
+    for (std::size_t i = 0; i < parts.size(); i++)
+        if (strlen(parts[i]->name) == len && !strncmp(parts[i]->name, name, len))
+            return id = (short)(-1 - (int)i), true;
+    return false;
+}
+
+const part* column_part(short id)
+{
+    return id < 0 ? part::all_parts()[(std::size_t)(-1 - id)] : columns[id].counts;
+}
+
+column_section column_section_of(short id)
+{
+    return id >= 0 ? columns[id].section : column_section::base;
+}
+
+bool read_line(FILE* stream, std::string& s)
 {
-    using variant = std::variant<int, float, float_format>;
-    auto mass_of = [&](const part& x) { return st.count(x) * x.mass; };
-    auto count_of = [&](const part& x) { return st.count(x); };
-
-    const std::tuple<const char*, variant> values[] = {
-        { "Cost",           st.cost                                 },
-        { "Mass",           st.mass                                 },
-        { "TWR",            float_format{st.twr(), 2}               },
-        { "hTWR",           float_format{st.horizontal_twr(), 2}    },
-        { "Combat time",    st.combat_time(),                       },
-        { "Speed",          st.speed(),                             },
-        { "Range",          st.range()                              },
-        { "Fuel usage",     st.fuel_usage()                         },
-        { "Armor",          mass_of(arm_1x1)                        },
-        { "Fuel",           (int)st.fuel                            },
-        //{ "Tanks (tons)",   mass_of(tank_1x2) + mass_of(tank_4x4)   },
-        { "D-30s",          count_of(e_d30s)                        },
-        { "D-30",           count_of(e_d30)                         },
-        { "NK-25",          count_of(e_nk25)                        },
-        { "RD-51",          count_of(e_rd51)                        },
-        { "RD-59",          count_of(e_rd59)                        },
-        { "Tank L",         count_of(tank_4x4)                      },
-        { "Tank S",         count_of(tank_1x2)                      },
-        { "Power S",        count_of(pwr_1x2)                       },
-        { "Power L",        count_of(pwr_2x2)                       },
-        { "Leg(1)",         count_of(leg1),                         },
-        { "Leg(2)",         count_of(leg2),                         },
-        { "Leg(3)",         count_of(leg3),                         },
-        { "Leg(4)",         count_of(leg4),                         },
-    };
+    s.clear();
+    char buf[4096];
+    while (fgets(buf, sizeof(buf), stream))
+    {
+        s += buf;
+        if (s.back() == '\n')
+        {
+            s.pop_back();
+            if (!s.empty() && s.back() == '\r')
+                s.pop_back();
+            return true;
+        }
+    }
+    return !s.empty();
+}
 
+bool report_csv(const ship& st, int k, bool with_seq, const column_list* selected)
+{
+    // the columns as asked for, or all of them but those of stages that weren't run
+    short ids[std::size(columns)];
+    const short* first = ids;
+    int count = 0;
+    if (selected && selected->enabled())
+    {
+        first = selected->ids;
+        count = selected->count;
+    }
+    else
+    {
+        const bool has_layout = st.width > 0;
+        const bool has_mission = st.mission.done;
+        const bool has_duel = st.duel.done;
+        for (std::size_t i = 0; i < std::size(columns); i++)
+            switch (columns[i].section)
+            {
+            case column_section::base:      ids[count++] = (short)i; break;
+            case column_section::layout:    if (has_layout) ids[count++] = (short)i; break;
+            case column_section::mission:   if (has_mission) ids[count++] = (short)i; break;
+            case column_section::duel:      if (has_duel) ids[count++] = (short)i; break;
+            case column_section::extra:     break;
+            }
+    }
+
+    // shards put the sequence number first, for hf-design-merge
     if (k == 0)
     {
         line s{stdout};
-        for (const auto& [name, _] : values)
-            s << name;
+        if (with_seq)
+            s << "Seq";
+        for (int i = 0; i < count; i++)
+            s << column_name(first[i]);
         putchar('\n');
     }
 
     line s{stdout};
     auto print = [&] (const auto& x) { s << x; };
 
-    for (const auto& [_, x] : values)
-        std::visit(print, x);
+    if (with_seq)
+        s << (unsigned long long)st.seq;
+    for (int i = 0; i < count; i++)
+        std::visit(print, column_value(st, first[i]));
     putchar('\n');
 
     return true;
 }
 
+bool report_columns(const ship& st, const column_list& selected)
+{
+    line s{stdout, ' '};
+    for (int i = 0; i < selected.count; i++)
+    {
+        s << column_name(selected.ids[i]);
+        s.write(':');
+        std::visit([&] (const auto& x) { s.write(x); }, column_value(st, selected.ids[i]));
+    }
+    printf(".\n");
+    return true;
+}
+
 } // namespace hf::design
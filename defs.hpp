@@ -17,7 +17,15 @@ inline void terminate(int status) { throw exit_status(status); }
 #else
 #   undef EX_SOFTWARE
 #   undef EX_USAGE
+#   undef EX_DATAERR
+#   undef EX_NOINPUT
+#   undef EX_CANTCREAT
+#   undef EX_IOERR
 #   define EX_SOFTWARE      70
 #   define EX_USAGE         64
+#   define EX_DATAERR       65
+#   define EX_NOINPUT       66
+#   define EX_CANTCREAT     73
+#   define EX_IOERR         74
 #endif
 
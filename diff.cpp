@@ -0,0 +1,556 @@
+#include "part.hpp"
+#include "part-list.hpp"
+#include "ship.hpp"
+#include "metric.hpp"
+#include "record.hpp"
+#include "report.hpp"
+#include "run-sort.hpp"
+#include "defs.hpp"
+#include "log.hpp"
+
+#include "getopt.h"
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+// tells which designs two result sets of hf-design have in common. each
+// design is known by a fingerprint of its part counts; both sets get
+// sorted by it, spilling runs to temporary files when they're large, and
+// are walked side by side. designs in only one of them were added or
+// removed, the rest changed if any metric did.
+
+namespace hf::design {
+
+namespace {
+
+enum class format : char { none, csv, bin };
+
+// the part count columns of report_csv(), the rest are metrics
+constexpr const char* csv_counts[] = {
+    "D-30s", "D-30", "NK-25", "RD-51", "RD-59", "Tank L", "Tank S", "Power S", "Power L",
+    "Leg(1)", "Leg(2)", "Leg(3)", "Leg(4)",
+};
+
+constexpr std::size_t run_memory = std::size_t{128} << 20; // per input, before spilling a run
+constexpr int seq_column = INT_MIN;
+
+std::vector<std::string> split(const std::string& s)
+{
+    std::vector<std::string> ret;
+    for (std::size_t pos = 0; ; )
+    {
+        const std::size_t end = std::min(s.find(',', pos), s.size());
+        ret.emplace_back(s, pos, end - pos);
+        if (end == s.size())
+            return ret;
+        pos = end + 1;
+    }
+}
+
+// strtod() for the plain decimals of report_csv(), a few times faster. a
+// mantissa of up to 15 digits divided by an exact power of ten rounds the
+// way strtod() does; anything else goes to it.
+double parse_number(const char* s, char** end)
+{
+    constexpr double powers[] = { 1, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15 };
+    const char* p = s + (*s == '-');
+    std::uint64_t mantissa = 0;
+    int digits = 0, decimals = -1;
+    for (; (*p >= '0' && *p <= '9') || (*p == '.' && decimals < 0); p++)
+        if (*p == '.')
+            decimals = 0;
+        else
+        {
+            mantissa = mantissa * 10 + (std::uint64_t)(*p - '0');
+            digits++;
+            decimals += decimals >= 0;
+        }
+    if (!digits || digits > 15 || (*p && *p != ','))
+        return std::strtod(s, end);
+    *end = const_cast<char*>(p);
+    const double x = (double)mantissa / powers[std::max(decimals, 0)];
+    return *s == '-' ? -x : x;
+}
+
+// a design as the diff sees it: the fingerprint and the row it came from,
+// then the metrics and the part counts, fixed in size for the input.
+// fingerprints are two independent 64-bit hashes of the nonzero counts by
+// part name, so they don't depend on column order and a mixup is out of
+// the question for any realistic number of designs.
+struct entry_layout final
+{
+    std::size_t num_metrics = 0, num_counts = 0;
+
+    static constexpr std::size_t head = 3 * sizeof(std::uint64_t);
+    std::size_t size() const { return head + num_metrics * sizeof(double) + num_counts * sizeof(std::uint16_t); }
+};
+
+std::uint64_t get_u64(const unsigned char* p, std::size_t i)
+{
+    std::uint64_t x;
+    memcpy(&x, p + i * sizeof(x), sizeof(x));
+    return x;
+}
+
+// fingerprint first, then the order of the input
+bool entry_less(const unsigned char* a, const unsigned char* b)
+{
+    for (std::size_t i = 0; i < 3; i++)
+        if (std::uint64_t x = get_u64(a, i), y = get_u64(b, i); x != y)
+            return x < y;
+    return false;
+}
+
+bool same_design(const unsigned char* a, const unsigned char* b)
+{
+    return get_u64(a, 0) == get_u64(b, 0) && get_u64(a, 1) == get_u64(b, 1);
+}
+
+// one of the two result sets, read a design at a time
+struct input final
+{
+    const char* name = nullptr;
+    FILE* stream = nullptr;
+    format kind = format::none; // none for an empty file
+    record_reader reader;
+    std::vector<std::string> metric_names, count_names;
+    std::vector<int> columns; // csv: metric i, -1 - i for count i, or seq_column
+    std::vector<std::size_t> by_name;         // counts in name order, for the fingerprint
+    entry_layout layout;
+    std::uint64_t row = 0;
+    std::string line;
+    ship st;
+    std::vector<double> metrics;
+    std::vector<int> counts;
+
+    void open(const char* filename);
+    bool next(unsigned char* entry);
+
+    ~input() { if (stream) fclose(stream); }
+
+private:
+    void finish(unsigned char* entry, const double* metrics, const int* counts);
+};
+
+void input::open(const char* filename)
+{
+    name = filename;
+    stream = fopen(name, "rb");
+    if (!stream)
+    {
+        ERR("%s: %s", name, strerror(errno));
+        terminate(EX_NOINPUT);
+    }
+
+    char magic[sizeof(record_header::magic)];
+    std::size_t n = fread(magic, 1, sizeof(magic), stream);
+    if (n == 0)
+        return;
+    if (n == sizeof(magic) && !memcmp(magic, record_header::magic, sizeof(magic)))
+    {
+        if (!reader.open(stream, name, true))
+            terminate(EX_DATAERR);
+        kind = format::bin;
+        for (const auto* x : part::all_parts())
+            if (!x->is_hull() && *x != arm_1x1 && *x != null_part)
+                count_names.emplace_back(x->name);
+        for (unsigned i = 0; i <= (unsigned)metric::win_rate; i++)
+            metric_names.emplace_back(metric_info_of((metric)i).name);
+        metric_names.emplace_back("armor");
+    }
+    else
+    {
+        rewind(stream);
+        std::string header;
+        if (!read_line(stream, header) || header.empty())
+        {
+            ERR("%s: neither csv nor bin output of hf-design", name);
+            terminate(EX_DATAERR);
+        }
+        const auto cols = split(header);
+        for (std::size_t i = 0; i < cols.size(); i++)
+        {
+            const bool count = std::find_if(std::begin(csv_counts), std::end(csv_counts),
+                                            [&](const char* x) { return cols[i] == x; }) != std::end(csv_counts);
+            if (cols[i] == "Seq")
+                columns.push_back(seq_column);
+            else if (count)
+            {
+                columns.push_back(-1 - (int)count_names.size());
+                count_names.push_back(cols[i]);
+            }
+            else
+            {
+                columns.push_back((int)metric_names.size());
+                metric_names.push_back(cols[i]);
+            }
+        }
+        if (count_names.empty())
+        {
+            ERR("%s: no part counts, not the csv output of hf-design", name);
+            terminate(EX_DATAERR);
+        }
+        kind = format::csv;
+    }
+    layout = { metric_names.size(), count_names.size() };
+    metrics.resize(layout.num_metrics);
+    counts.resize(layout.num_counts);
+    by_name.resize(count_names.size());
+    std::iota(by_name.begin(), by_name.end(), 0);
+    std::sort(by_name.begin(), by_name.end(), [&](std::size_t a, std::size_t b) {
+        return count_names[a] < count_names[b];
+    });
+}
+
+bool input::next(unsigned char* entry)
+{
+    switch (kind)
+    {
+    case format::bin: {
+        if (!reader.read(st))
+            return false;
+        std::size_t k = 0;
+        for (const auto* x : part::all_parts())
+            if (!x->is_hull() && *x != arm_1x1 && *x != null_part)
+                counts[k++] = st.count(*x);
+        for (std::size_t i = 0; i + 1 < layout.num_metrics; i++)
+        {
+            const auto m = (metric)i;
+            const auto stage = metric_info_of(m).stage;
+            const bool there = (m != metric::width && m != metric::height && m != metric::perimeter) || st.width > 0;
+            metrics[i] = !there || (stage == metric_info::mission && !st.mission.done) ||
+                         (stage == metric_info::duel && !st.duel.done) ? NAN : metric_value(st, m);
+        }
+        metrics.back() = st.count(arm_1x1) * (double)arm_1x1.mass;
+        break;
+    }
+    case format::csv: {
+        if (!read_line(stream, line))
+            return false;
+        // in place, the rows are many
+        const char* pos = line.c_str();
+        for (std::size_t col = 0; ; col++)
+        {
+            char* end;
+            errno = 0;
+            const double x = col < columns.size() ? parse_number(pos, &end) : 0;
+            if (col >= columns.size() || end == pos || (*end && *end != ',') || errno ||
+                (!*end && col + 1 != columns.size()))
+            {
+                ERR("%s: bad row %llu -- '%s'", name, (unsigned long long)row + 1, line.c_str());
+                terminate(EX_DATAERR);
+            }
+            if (const int at = columns[col]; at >= 0)
+                metrics[(std::size_t)at] = x;
+            else if (at != seq_column)
+                counts[(std::size_t)(-1 - at)] = (int)x;
+            if (!*end)
+                break;
+            pos = end + 1;
+        }
+        break;
+    }
+    default:
+        return false;
+    }
+    finish(entry, metrics.data(), counts.data());
+    row++;
+    return true;
+}
+
+void input::finish(unsigned char* entry, const double* metrics, const int* counts)
+{
+    // FNV-1a and a multiply-rotate hash over name, count pairs
+    std::uint64_t h1 = 0xcbf29ce484222325, h2 = 0x9e3779b97f4a7c15;
+    const auto add = [&](unsigned char c) {
+        h1 = (h1 ^ c) * 0x100000001b3;
+        h2 = (h2 ^ c) * 0xff51afd7ed558ccd;
+        h2 = h2 << 31 | h2 >> 33;
+    };
+    for (std::size_t i : by_name)
+    {
+        if (!counts[i])
+            continue;
+        for (const char* s = count_names[i].c_str(); ; s++)
+        {
+            add((unsigned char)*s);
+            if (!*s)
+                break;
+        }
+        for (int k = 0; k < 4; k++)
+            add((unsigned char)((unsigned)counts[i] >> 8 * k));
+    }
+    unsigned char* p = entry;
+    for (std::uint64_t x : { h1, h2, row })
+    {
+        memcpy(p, &x, sizeof(x));
+        p += sizeof(x);
+    }
+    memcpy(p, metrics, layout.num_metrics * sizeof(double));
+    p += layout.num_metrics * sizeof(double);
+    for (std::size_t i = 0; i < layout.num_counts; i++, p += sizeof(std::uint16_t))
+    {
+        const auto x = (std::uint16_t)std::clamp(counts[i], 0, 0xffff);
+        memcpy(p, &x, sizeof(x));
+    }
+}
+
+// the designs of an input by fingerprint. what doesn't fit in run_memory
+// goes to temporary files in sorted runs, merged again as it's read.
+struct sorted_input final
+{
+    explicit sorted_input(input& in);
+
+    // the next design in fingerprint order, null at the end
+    const unsigned char* next() { return sorter.next(); }
+
+private:
+    run_sorter sorter;
+};
+
+sorted_input::sorted_input(input& x) :
+    sorter{x.layout.size(), entry_layout::head / sizeof(std::uint64_t), run_memory}
+{
+    std::vector<unsigned char> entry(x.layout.size());
+    while (x.next(entry.data()))
+        memcpy(sorter.push(), entry.data(), entry.size());
+    sorter.finish();
+}
+
+struct differ final
+{
+    const input &a, &b;
+    double tolerance;
+    std::uint64_t limit, printed = 0;
+    std::uint64_t added = 0, removed = 0, changed = 0, same = 0;
+    std::vector<int> b_metric; // of each of a's metrics, -1 if b has none
+
+    differ(const input& a, const input& b, double tolerance, std::uint64_t limit);
+    void run(sorted_input& x, sorted_input& y);
+
+private:
+    static double metric_at(const unsigned char* entry, std::size_t i);
+    static bool differs(double x, double y, double tolerance);
+    void print_design(char mark, const input& x, const unsigned char* entry);
+    void print_metrics(const input& x, const unsigned char* entry);
+    void compare(const unsigned char* p, const unsigned char* q);
+};
+
+differ::differ(const input& a, const input& b, double tolerance, std::uint64_t limit) :
+    a{a}, b{b}, tolerance{tolerance}, limit{limit}
+{
+    for (const auto& name : a.metric_names)
+    {
+        const auto it = std::find(b.metric_names.begin(), b.metric_names.end(), name);
+        b_metric.push_back(it == b.metric_names.end() ? -1 : (int)(it - b.metric_names.begin()));
+    }
+}
+
+double differ::metric_at(const unsigned char* entry, std::size_t i)
+{
+    double ret;
+    memcpy(&ret, entry + entry_layout::head + i * sizeof(double), sizeof(ret));
+    return ret;
+}
+
+bool differ::differs(double x, double y, double tolerance)
+{
+    if (std::isnan(x) || std::isnan(y)) // not there on one side
+        return false;
+    return std::fabs(x - y) > tolerance * std::max(std::fabs(x), std::fabs(y));
+}
+
+void differ::print_design(char mark, const input& x, const unsigned char* entry)
+{
+    const unsigned char* p = entry + entry_layout::head + x.layout.num_metrics * sizeof(double);
+    printf("%c", mark);
+    for (std::size_t i = 0; i < x.layout.num_counts; i++)
+    {
+        std::uint16_t n;
+        memcpy(&n, p + i * sizeof(n), sizeof(n));
+        if (n)
+            printf(" %s:%u", x.count_names[i].c_str(), (unsigned)n);
+    }
+    printf(" |");
+}
+
+void differ::print_metrics(const input& x, const unsigned char* entry)
+{
+    for (std::size_t i = 0; i < x.layout.num_metrics; i++)
+        if (double v = metric_at(entry, i); !std::isnan(v))
+            printf(" %s:%g", x.metric_names[i].c_str(), v);
+    printf("\n");
+}
+
+void differ::compare(const unsigned char* p, const unsigned char* q)
+{
+    bool any = false;
+    for (std::size_t i = 0; i < a.layout.num_metrics && !any; i++)
+        any = b_metric[i] >= 0 && differs(metric_at(p, i), metric_at(q, (std::size_t)b_metric[i]), tolerance);
+    if (!any)
+    {
+        same++;
+        return;
+    }
+    changed++;
+    if (printed++ >= limit)
+        return;
+    print_design('~', b, q);
+    for (std::size_t i = 0; i < a.layout.num_metrics; i++)
+    {
+        if (b_metric[i] < 0)
+            continue;
+        const double x = metric_at(p, i), y = metric_at(q, (std::size_t)b_metric[i]);
+        if (differs(x, y, tolerance))
+            printf(" %s:%g>%g(%+g)", a.metric_names[i].c_str(), x, y, y - x);
+    }
+    printf("\n");
+}
+
+void differ::run(sorted_input& x, sorted_input& y)
+{
+    const unsigned char *p = x.next(), *q = y.next();
+    while (p || q)
+    {
+        // a fingerprint in both pairs up in input order; the surplus on
+        // either side counts as added or removed
+        if (p && q && same_design(p, q))
+        {
+            compare(p, q);
+            p = x.next();
+            q = y.next();
+        }
+        else if (q && (!p || entry_less(q, p)))
+        {
+            added++;
+            if (printed++ < limit)
+            {
+                print_design('+', b, q);
+                print_metrics(b, q);
+            }
+            q = y.next();
+        }
+        else
+        {
+            removed++;
+            if (printed++ < limit)
+            {
+                print_design('-', a, p);
+                print_metrics(a, p);
+            }
+            p = x.next();
+        }
+    }
+}
+
+[[noreturn]] void usage(const char* argv0)
+{
+    printf("usage: %s [-n <int>] [-t <float>] <old> <new>\n", argv0);
+    printf("this program compares two result sets of hf-design, both csv or both bin.\n\n");
+    printf("  %-29s %s\n", "-n <int>", "print at most that many differences");
+    printf("  %-29s %s\n", "-t <float>", "relative change of a metric to ignore");
+    printf("  %-29s %s\n", "-h", "this screen");
+    printf("\ndesigns are matched by their part counts. lines start with + for added,\n"
+           "- for removed and ~ for changed, which shows metric:old>new(delta).\n"
+           "they come in no particular order, a count of each goes to stderr. the\n"
+           "exit status is 1 if the sets differ.\n");
+    printf("\nexample: %s -t 0.001 before.csv after.csv\n", argv0);
+    fflush(stdout);
+    terminate(stdout == stderr ? EX_USAGE : 0);
+}
+
+} // namespace
+
+extern "C" int main(int argc, char** argv)
+{
+#ifdef _WIN32
+    if (const char* c = strrchr(argv[0], '.'); c && *c)
+        argv[0][c - argv[0]] = '\0';
+    argv[0] = std::max(argv[0], strrchr(argv[0], '\\')+1);
+#endif
+    argv[0] = std::max(argv[0], strrchr(argv[0], '/')+1);
+
+    try {
+        std::uint64_t limit = UINT64_MAX;
+        double tolerance = 0;
+        for (int c; (c = musl_getopt(argc, argv, "n:t:h")) != -1; )
+            switch (c)
+            {
+            case 'n': {
+                char* end;
+                errno = 0;
+                long n = std::strtol(musl_optarg, &end, 10);
+                if (end == musl_optarg || *end || errno || n < 0 || n > INT_MAX)
+                {
+                    ERR("invalid output limit -- '%s'", musl_optarg);
+                    goto error;
+                }
+                limit = n ? (std::uint64_t)n : UINT64_MAX;
+                break;
+            }
+            case 't': {
+                char* end;
+                errno = 0;
+                tolerance = std::strtod(musl_optarg, &end);
+                if (end == musl_optarg || *end || errno || !(tolerance >= 0 && tolerance < 1))
+                {
+                    ERR("invalid tolerance, expected 0 to 1 -- '%s'", musl_optarg);
+                    goto error;
+                }
+                break;
+            }
+            case 'h':
+                usage(argv[0]);
+            default:
+                goto error;
+            }
+        if (musl_optind == argc)
+            usage(argv[0]);
+        if (argc - musl_optind != 2)
+        {
+            ERR("expected two files");
+            goto error;
+        }
+
+        {
+            input a, b;
+            a.open(argv[musl_optind]);
+            b.open(argv[musl_optind + 1]);
+            if (a.kind != format::none && b.kind != format::none && a.kind != b.kind)
+            {
+                ERR("%s: can't compare csv and bin", b.name);
+                terminate(EX_USAGE);
+            }
+            if (a.kind == format::csv && b.kind == format::csv && a.count_names != b.count_names)
+            {
+                ERR("%s: other part count columns than %s", b.name, a.name);
+                terminate(EX_DATAERR);
+            }
+            sorted_input x{a}, y{b};
+            differ d{a, b, tolerance, limit};
+            d.run(x, y);
+            fflush(stdout);
+            INFO("%llu added, %llu removed, %llu changed, %llu the same",
+                 (unsigned long long)d.added, (unsigned long long)d.removed,
+                 (unsigned long long)d.changed, (unsigned long long)d.same);
+            return d.added || d.removed || d.changed;
+        }
+error:
+        fprintf(stderr, "Try '%s -h' for more information.\n", argv[0]);
+        return EX_USAGE;
+    } catch (const exit_status& x) {
+        return x.code;
+    }
+}
+
+} // namespace hf::design
@@ -0,0 +1,111 @@
+// no include guard -- part of the search kernel, included by
+// search-kernel.hpp once per instruction set.
+
+namespace hf::design::HF_DESIGN_ISA {
+
+// counter-based, splitmix64's finalizer over the key and the counter. the
+// draws of a duel only depend on the design, the duel and the second, not
+// on which thread fights it or in what order.
+HF_DESIGN_TARGET static inline std::uint64_t duel_draw(std::uint64_t key, std::uint64_t ctr)
+{
+    std::uint64_t z = key + ctr * 0x9e3779b97f4a7c15;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+// duels side by side, one per lane, so that every second of them is one
+// straight loop across lanes.
+struct duel_lanes final
+{
+    static constexpr int size = 64;
+
+    float hp[size], enemy_hp[size];
+};
+
+// 'a' against 'b' 'n' times, the share won. each second a side that has
+// ammo left lands shots * hit chance hits, rounded up or down at random,
+// for per_shot times .5 to 1.5 each. both fire at once, so both may die.
+HF_DESIGN_TARGET static float fight(const fighter& a, const fighter& b, std::uint64_t key, int n)
+{
+    constexpr float unit = 1.f / 65536;
+    constexpr int check_interval = 8; // seconds between looking for duels still on
+    const float hits_a = a.shots * b.hit_chance(), hits_b = b.shots * a.hit_chance();
+    const int steps = std::min(duel_options::max_steps, (int)std::ceil(std::max(a.volleys, b.volleys)));
+    duel_lanes d;
+    float won = 0;
+
+    for (int first = 0; first < n; first += duel_lanes::size)
+    {
+        for (int i = 0; i < duel_lanes::size; i++)
+        {
+            d.hp[i] = a.hp;
+            d.enemy_hp[i] = b.hp;
+        }
+        for (int t = 0; t < steps; t++)
+        {
+            const float fire_a = (float)t < a.volleys ? a.per_shot : 0;
+            const float fire_b = (float)t < b.volleys ? b.per_shot : 0;
+            for (int i = 0; i < duel_lanes::size; i++)
+            {
+                const std::uint64_t z = duel_draw(key, (std::uint64_t)(first + i) * duel_options::max_steps +
+                                                       (std::uint64_t)t);
+                const float u0 = (float)(int)(z & 0xffff) * unit, u1 = (float)(int)(z >> 16 & 0xffff) * unit;
+                const float u2 = (float)(int)(z >> 32 & 0xffff) * unit, u3 = (float)(int)(z >> 48) * unit;
+                const float on = (float)((d.hp[i] > 0) & (d.enemy_hp[i] > 0)); // no branches, so it vectorizes
+                d.enemy_hp[i] -= on * (float)(int)(hits_a + u0) * fire_a * (.5f + u1);
+                d.hp[i] -= on * (float)(int)(hits_b + u2) * fire_b * (.5f + u3);
+            }
+            if ((t + 1) % check_interval == 0)
+            {
+                int any = 0;
+                for (int i = 0; i < duel_lanes::size; i++)
+                    any |= (d.hp[i] > 0) & (d.enemy_hp[i] > 0);
+                if (!any)
+                    break;
+            }
+        }
+        const int lanes = std::min(duel_lanes::size, n - first);
+        for (int i = 0; i < lanes; i++)
+        {
+            const bool alive = d.hp[i] > 0, enemy_alive = d.enemy_hp[i] > 0;
+            won += alive == enemy_alive ? .5f : alive ? 1 : 0;
+        }
+    }
+    return won / (float)n;
+}
+
+struct duel_work final
+{
+    ship* ships;
+    const int* which;
+    const fighter* enemy;
+    std::uint64_t seed;
+    int duels;
+};
+
+HF_DESIGN_TARGET static void fight_design(void* ctx, int item)
+{
+    const auto& w = *(const duel_work*)ctx;
+    auto& st = w.ships[w.which[item]];
+    st.duel.win_rate = fight(fighter_of(st), *w.enemy, duel_draw(w.seed, st.seq), w.duels);
+    st.duel.done = true;
+}
+
+// ships[which[0..n-1]] against the --duel enemy, across the pool's threads
+// when there is one
+HF_DESIGN_TARGET static void fight_duels(ship* ships, const int* which, int n, const fighter& enemy,
+                                         const cmdline& params, duel_pool* pool)
+{
+    if (!n)
+        return;
+    trace_span t{"duels"};
+    duel_work w{ ships, which, &enemy, params.anytime.seed, params.duel.duels };
+    if (pool)
+        pool->run(n, fight_design, &w);
+    else
+        for (int i = 0; i < n; i++)
+            fight_design(&w, i);
+}
+
+} // namespace hf::design::HF_DESIGN_ISA
@@ -0,0 +1,40 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hf::design {
+
+// helper threads for the duels of a batch of designs, and for the blocks
+// of --eval. run() hands out items 0 to n-1 to them and to the calling
+// thread, and returns when all are done. 'fn' is a plain function so
+// that the kernel can pass one compiled for its instruction set.
+struct duel_pool final
+{
+    using work_fn = void(*)(void* ctx, int item);
+
+    explicit duel_pool(int threads); // the calling one included
+    ~duel_pool();
+    duel_pool(const duel_pool&) = delete;
+    duel_pool& operator=(const duel_pool&) = delete;
+
+    void run(int n, work_fn fn, void* ctx);
+
+private:
+    void work();
+    void take();
+
+    std::vector<std::thread> threads;
+    std::mutex lock;
+    std::condition_variable wakeup, finished;
+    work_fn fn = nullptr;
+    void* ctx = nullptr;
+    std::atomic<int> next{0};
+    int count = 0, busy = 0;
+    unsigned generation = 0;
+    bool quit = false;
+};
+
+} // namespace hf::design
@@ -0,0 +1,130 @@
+#include "duel.hpp"
+#include "duel-pool.hpp"
+#include "part.hpp"
+#include "part-list.hpp"
+#include "ship.hpp"
+#include "catalog.hpp"
+
+namespace hf::design {
+
+namespace {
+
+// what guns firing 'weight' units of ammo a volley do with 'ammo' units on board
+void arm(fighter& x, int shots, int weight, int ammo)
+{
+    x.shots = (float)shots;
+    x.per_shot = shots ? fighter::damage * (float)weight / (float)shots : 0;
+    x.volleys = weight ? fighter::volleys_per_ammo * (float)ammo / (float)weight : 0;
+}
+
+} // namespace
+
+fighter fighter_of(const ship& st)
+{
+    fighter ret;
+    int shots = 0, weight = 0, ammo = 0;
+    float hull = 0;
+    const part_catalog& catalog = *st.catalog;
+    for (const auto* x : part::all_parts())
+    {
+        const int n = st.count(*x);
+        if (!n)
+            continue;
+        const part_values& v = catalog[*x];
+        if (v.ammo < 0)
+        {
+            shots += n;
+            weight -= v.ammo * n;
+        }
+        else if (v.ammo > 0)
+            ammo += v.ammo * n;
+        else if (x->is_hull())
+            hull += v.mass * (float)n;
+    }
+    arm(ret, shots, weight, ammo);
+    ret.hp = fighter::armor_hp * (float)st.count(arm_1x1) * catalog[arm_1x1].mass + fighter::hull_hp * hull;
+    ret.htwr = st.horizontal_twr();
+    return ret;
+}
+
+fighter duel_options::enemy(const part_catalog& catalog) const
+{
+    fighter ret;
+    int shots = 0, weight = 0;
+    for (int i = 0; i < num_guns; i++)
+    {
+        shots += guns[i].second;
+        weight -= catalog[*guns[i].first].ammo * guns[i].second;
+    }
+    arm(ret, shots, weight, weight);
+    ret.hp = fighter::armor_hp * armor + fighter::hull_hp * hull;
+    ret.htwr = htwr;
+    return ret;
+}
+
+duel_pool::duel_pool(int threads_)
+{
+    for (int i = 1; i < threads_; i++)
+        threads.emplace_back([this] { work(); });
+}
+
+duel_pool::~duel_pool()
+{
+    {
+        std::lock_guard g{lock};
+        quit = true;
+    }
+    wakeup.notify_all();
+    for (auto& t : threads)
+        t.join();
+}
+
+void duel_pool::take()
+{
+    for (int i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count; )
+        fn(ctx, i);
+}
+
+void duel_pool::work()
+{
+    unsigned seen = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock g{lock};
+            wakeup.wait(g, [&] { return quit || generation != seen; });
+            if (quit)
+                return;
+            seen = generation;
+        }
+        take();
+        std::lock_guard g{lock};
+        if (!--busy)
+            finished.notify_one();
+    }
+}
+
+void duel_pool::run(int n, work_fn fn_, void* ctx_)
+{
+    if (threads.empty() || n == 1)
+    {
+        for (int i = 0; i < n; i++)
+            fn_(ctx_, i);
+        return;
+    }
+    {
+        std::lock_guard g{lock};
+        fn = fn_;
+        ctx = ctx_;
+        count = n;
+        next.store(0, std::memory_order_relaxed);
+        busy = (int)threads.size();
+        generation++;
+    }
+    wakeup.notify_all();
+    take();
+    std::unique_lock g{lock};
+    finished.wait(g, [&] { return !busy; });
+}
+
+} // namespace hf::design
@@ -0,0 +1,58 @@
+#pragma once
+#include <utility>
+
+namespace hf::design {
+
+struct part;
+struct part_catalog;
+struct ship;
+
+// a side of a duel as the simulator sees it. guns fire one volley a
+// second until the ammo is gone; each shot hits with a chance that drops
+// with the target's horizontal twr and does damage by the gun's ammo
+// use. armor and hull are one pool of hit points, armor counting double.
+struct fighter final
+{
+    static constexpr float accuracy = .7f;      // hit chance at htwr 0
+    static constexpr float evasion_htwr = 2;    // htwr that halves it
+    static constexpr float damage = 300;        // per unit of ammo use per hit
+    static constexpr float volleys_per_ammo = 30;
+    static constexpr float armor_hp = 2, hull_hp = 1; // per unit of mass
+
+    float shots = 0;    // guns
+    float per_shot = 0; // damage of a hit
+    float volleys = 0;  // before the ammo runs out
+    float hp = 0;
+    float htwr = 0;
+
+    // of a shot at this side
+    float hit_chance() const { return accuracy / (1 + htwr / evasion_htwr); }
+};
+
+// guns, ammo, armor and hull parts of a design, by its catalog, and its htwr
+fighter fighter_of(const ship& st);
+
+// --duel: the reference enemy and how many duels a design fights it.
+// its guns come with their ammo as on the ship; armor and hull are mass.
+struct duel_options final
+{
+    static constexpr int max_guns = 8;
+    static constexpr int max_steps = 600; // seconds, then it's a draw
+
+    std::pair<const part*, int> guns[max_guns] = {};
+    int num_guns = 0;
+    float armor = 1000, hull = 300, htwr = 3;
+    int duels = 1000;
+    bool enabled = false;
+
+    fighter enemy(const part_catalog& catalog) const;
+};
+
+// per-design result, draws counting half
+struct duel_result final
+{
+    float win_rate = 0;
+    bool done = false;
+};
+
+} // namespace hf::design
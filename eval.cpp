@@ -0,0 +1,684 @@
+#include "eval.hpp"
+#include "search.hpp"
+#include "cmdline.hpp"
+#include "filter.hpp"
+#include "record.hpp"
+#include "duel-pool.hpp"
+#include "part.hpp"
+#include "part-list.hpp"
+#include "ship.hpp"
+#include "report.hpp"
+#include "trace.hpp"
+#include "defs.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hf::design {
+
+namespace {
+
+constexpr int rows_per_item = 1024;
+constexpr int max_items = 64; // a block of designs, read before evaluating any
+constexpr std::size_t text_chunk = std::size_t{4} << 20;
+constexpr int max_count = 65535; // what a record holds
+
+enum row_status : unsigned char { row_blank, row_bad, row_out, row_in };
+
+// one add_part_() of the search, in its order. how many of the part a
+// row gets is worked out by mount() into a column of counts of its own.
+struct term final
+{
+    enum rule_ : unsigned char
+    {
+        rest,       // all the file has left of it
+        constant,   // 'arg' of them
+        hull,       // as many as term 'arg' added
+        twice,      // twice as many
+        ammo_big,   // the ammo of the guns of term 'arg', as add_gun()
+        ammo_small,
+        one_leg,    // the leg on a corner, see single_leg_mount()
+        own_tanks,  // the small tanks with hulls, see sneaky_tanks()
+    };
+
+    const part* x; // nullptr for -m and -p
+    ship::area_mode amode;
+    rule_ rule;
+    bool clip;     // at most what the file has left of it
+    int arg = 0;
+    int file = -1; // the column of counts of the part in the file, or -1
+};
+
+// one thread's share of a block, the totals kept column by column so
+// that adding up a part runs over all of its rows at once
+struct item final
+{
+    std::vector<int> counts; // rows_per_item for each column
+    std::vector<int> left;   // of a row's counts, by mount()
+    float mass[rows_per_item], power[rows_per_item], fuel[rows_per_item], fuel_flow[rows_per_item];
+    float thrust[rows_per_item], horizontal_thrust[rows_per_item];
+    int area[rows_per_item], cost[rows_per_item];
+    row_status status[rows_per_item];
+    filter filter_ship;
+    ship st;
+};
+
+struct line_span final
+{
+    const char* begin;
+    const char* end;
+};
+
+struct evaluator final
+{
+    const cmdline& params;
+    search_control& control;
+    const char* name;
+    FILE* in;
+
+    // the file's columns: the column of counts each goes to, or -1. the
+    // terms' columns come after those of the file's parts.
+    std::vector<int> columns;
+    unsigned num_parts = 0, num_counts = 0;
+    // hf-design's Armor, a mass, and the column of armor counts it makes
+    int armor_at = -1, armor_count = -1;
+    std::vector<term> terms;
+    int d30s_at = -1, rd51_at = -1; // terms
+    ship start; // before the first term
+
+    duel_pool pool{(int)std::max(1u, std::thread::hardware_concurrency())};
+    std::vector<std::unique_ptr<item>> items;
+    int num_rows = 0;
+
+    // the block being evaluated: lines of csv, or records
+    const line_span* lines = nullptr;
+    const unsigned char* records = nullptr;
+    std::size_t record_size = 0, counts_at = 0;
+    std::uint64_t first_row = 0; // of the block, in the file
+
+    evaluator(const ship& base, const cmdline& params, search_control& control);
+    ~evaluator();
+
+    void map_columns(const std::vector<std::string>& names);
+    void parse_header(line_span x);
+    row_status parse_line(item& b, int r, line_span x) const;
+    void read_record(item& b, int r, const unsigned char* x) const;
+    void mount(item& b, int n) const;
+    void add_up(item& b, int n) const;
+    void fill(ship& st, const item& b, int r) const;
+    static void evaluate(void* ctx, int i);
+    bool run_block(); // false once -n designs are out
+    void run_text(std::string head);
+    void run_records();
+    void run();
+};
+
+evaluator::evaluator(const ship& base, const cmdline& params, search_control& control) :
+    params{params}, control{control}, name{strcmp(params.eval, "-") ? params.eval : "stdin"},
+    in{strcmp(params.eval, "-") ? fopen(params.eval, "rb") : stdin},
+    start{base}
+{
+    if (!in)
+    {
+        ERR("%s: %s", name, strerror(errno));
+        terminate(EX_NOINPUT);
+    }
+}
+
+evaluator::~evaluator()
+{
+    if (in != stdin)
+        fclose(in);
+}
+
+// parts the file names once, by part name or hf-design's csv header,
+// each to its column of counts. metrics are worked out again and left
+// out. with no hulls among them the parts are mounted as the search
+// does it and the ship has its bridge, guns and extinguishers.
+// several guns in the file are added by name, the search adds them in
+// the command line's order.
+void evaluator::map_columns(const std::vector<std::string>& names)
+{
+    std::vector<const part*> parts;
+    std::string unknown;
+    bool has_hulls = false, has_guns = false, has_fire = false;
+    short armor_id = -1, id;
+    find_column("Armor", 5, armor_id);
+    for (const auto& s : names)
+    {
+        const part* x = &params.catalog->find(s.data(), s.size());
+        if (*x == null_part && find_column(s.data(), s.size(), id))
+        {
+            if (id == armor_id)
+                armor_at = (int)columns.size();
+            if (!(x = column_part(id)))
+            {
+                columns.push_back(-1);
+                continue;
+            }
+        }
+        if (*x == null_part)
+        {
+            if (!s.empty() && s != null_part.name)
+                unknown += (unknown.empty() ? "" : ", ") + s;
+            columns.push_back(-1);
+            continue;
+        }
+        if (std::find(parts.begin(), parts.end(), x) != parts.end())
+        {
+            ERR("%s: part '%s' twice in the header", name, x->name);
+            terminate(EX_DATAERR);
+        }
+        columns.push_back((int)parts.size());
+        parts.push_back(x);
+        has_hulls = has_hulls || x->is_hull();
+        has_guns = has_guns || (*params.catalog)[*x].ammo < 0;
+        has_fire = has_fire || *x == fire;
+    }
+    if (armor_at >= 0 && std::find(parts.begin(), parts.end(), &arm_1x1) == parts.end())
+    {
+        armor_count = (int)parts.size();
+        parts.push_back(&arm_1x1);
+    }
+    else
+        armor_at = -1;
+    if (parts.empty())
+    {
+        ERR("%s: no part names in the header", name);
+        terminate(EX_DATAERR);
+    }
+    if (!unknown.empty())
+        WARN("%s: not parts, left out: %s", name, unknown.c_str());
+    num_parts = (unsigned)parts.size();
+
+    bool base_has_guns = false;
+    for (const auto* x : part::all_parts())
+        base_has_guns = base_has_guns || (start.count(*x) && (*params.catalog)[*x].ammo < 0);
+    if (base_has_guns && (has_guns || has_hulls))
+    {
+        ERR("%s: the file has the designs' guns, give none on the command line", name);
+        terminate(EX_USAGE);
+    }
+    if (has_hulls)
+    {
+        // a ship with nothing on it, not even the bridge
+        for (auto& [_, n] : start.parts)
+            n = 0;
+        start.mass = start.power = start.fuel = start.fuel_flow = start.thrust = start.horizontal_thrust = 0;
+        start.area = start.cost = start.sneaky_corners_left = 0;
+        std::fill(std::begin(start.footprints), std::end(start.footprints), 0);
+    }
+
+    // the search's add_part_() calls in its order, so the totals come out
+    // as it had them, then what's left of the file's parts. without hulls
+    // in the file they're added as the search would, with them the file's
+    // are used up.
+    const auto add = [&](const part* x, ship::area_mode amode, term::rule_ rule, int arg = 0, bool clip = true) {
+        const auto it = std::find(parts.begin(), parts.end(), x);
+        terms.push_back({ x, amode, rule, clip, arg, it == parts.end() ? -1 : (int)(it - parts.begin()) });
+        return (int)terms.size() - 1;
+    };
+    // add_part(): the part, then as many of its hull
+    const auto add_hulled = [&](const part& x, term::rule_ rule, int arg = 0, bool clip = true) {
+        const int ret = add(&x, ship::area_enabled, rule, arg, clip);
+        const part& hull = params.catalog->hull_of(x);
+        if (hull != h_null && hull != null_part)
+            add(&hull, ship::area_disabled, term::hull, ret, has_hulls);
+        return ret;
+    };
+    if (has_hulls)
+        add(&bridge, ship::area_enabled, term::rest);
+    for (const auto* x : parts)
+        if ((*params.catalog)[*x].ammo < 0)
+        {
+            const int gun = add_hulled(*x, term::rest);
+            add_hulled(ammo_2x2, term::ammo_big, gun);
+            add_hulled(ammo_1x2, term::ammo_small, gun);
+        }
+    add(nullptr, ship::area_disabled, term::constant, 0, false);
+    d30s_at = add_hulled(e_d30s, term::rest);
+    rd51_at = add_hulled(e_rd51, term::rest);
+    for (const auto* x : { &e_d30, &e_nk25, &e_rd59 })
+        add_hulled(*x, term::rest);
+    if (params.chassis.enabled())
+    {
+        add(&h_cor, ship::area_disabled, term::constant, params.chassis.nlegs ? params.chassis.nlegs : 2, has_hulls);
+        for (const auto* x : { &leg1, &leg2, &leg3, &leg4 })
+            add(x, ship::area_disabled, term::rest);
+    }
+    else
+    {
+        add_hulled(leg2, term::one_leg);
+        add(&leg2, ship::area_disabled, term::rest);
+        add(&leg1, ship::area_disabled, term::rest);
+    }
+    add(&tank_4x4, ship::area_enabled, term::rest);
+    add_hulled(tank_1x2, term::own_tanks);
+    add(&h_05, ship::area_disabled, term::twice, add(&tank_1x2, ship::area_disabled, term::rest), has_hulls);
+    if (has_hulls || has_fire)
+        add_hulled(fire, term::rest);
+    else
+        add_hulled(fire, term::constant, params.extinguishers.min, false);
+    for (const auto* x : { &pwr_1x2, &pwr_2x2, &arm_1x1 })
+        add_hulled(*x, term::rest);
+    for (const auto* x : parts)
+    {
+        const bool has_area = x->area() > 0 && !x->is_hull();
+        if (has_hulls || !has_area)
+            add(x, has_area ? ship::area_enabled : ship::area_disabled, term::rest);
+        else
+            add_hulled(*x, term::rest);
+    }
+    num_counts = num_parts + (unsigned)terms.size();
+}
+
+void evaluator::parse_header(line_span x)
+{
+    std::vector<std::string> names;
+    for (const char* s = x.begin; ; )
+    {
+        const char* end = std::find(s, x.end, ',');
+        const char *a = s, *b = end;
+        while (a < b && (*a == ' ' || *a == '\t'))
+            a++;
+        while (b > a && (b[-1] == ' ' || b[-1] == '\t' || b[-1] == '\r'))
+            b--;
+        if (b - a >= 2 && *a == '"' && b[-1] == '"')
+            a++, b--;
+        names.emplace_back(a, b);
+        if (end == x.end)
+            break;
+        s = end + 1;
+    }
+    map_columns(names);
+}
+
+row_status evaluator::parse_line(item& b, int r, line_span x) const
+{
+    const char* s = x.begin;
+    const char* end = x.end;
+    if (end > s && end[-1] == '\r')
+        end--;
+    if (s == end)
+        return row_blank;
+    for (std::size_t i = 0; ; i++)
+    {
+        if (i == columns.size())
+            return row_bad;
+        const char* field_end = std::find(s, end, ',');
+        if ((int)i == armor_at)
+        {
+            // the count that makes that mass at the built-in armor's
+            char buf[32], *num_end;
+            const auto len = (std::size_t)(field_end - s);
+            if (len >= sizeof(buf))
+                return row_bad;
+            memcpy(buf, s, len);
+            buf[len] = '\0';
+            const double mass = std::strtod(buf, &num_end);
+            while (*num_end == ' ')
+                num_end++;
+            if (num_end == buf || *num_end || !(mass >= 0 && mass < arm_1x1.mass * max_count))
+                return row_bad;
+            b.counts[(std::size_t)armor_count * rows_per_item + (unsigned)r] = (int)std::lround(mass / arm_1x1.mass);
+            s = field_end;
+        }
+        else if (const int k = columns[i]; k >= 0)
+        {
+            while (s < field_end && *s == ' ')
+                s++;
+            int n = 0;
+            for (; s < field_end && *s >= '0' && *s <= '9'; s++)
+                if ((n = n * 10 + (*s - '0')) > max_count)
+                    return row_bad;
+            while (s < field_end && *s == ' ')
+                s++;
+            if (s != field_end)
+                return row_bad;
+            b.counts[(std::size_t)k * rows_per_item + (unsigned)r] = n;
+        }
+        if (field_end == end)
+            return i + 1 == columns.size() ? row_out : row_bad;
+        s = field_end + 1;
+    }
+}
+
+void evaluator::read_record(item& b, int r, const unsigned char* x) const
+{
+    const unsigned char* p = x + counts_at;
+    for (std::size_t i = 0; i < columns.size(); i++, p += 2)
+        if (const int k = columns[i]; k >= 0)
+        {
+            std::uint16_t n;
+            memcpy(&n, p, sizeof(n));
+            b.counts[(std::size_t)k * rows_per_item + (unsigned)r] = n;
+        }
+}
+
+// the count of each term for each row, as the search would have added
+// the row's parts
+void evaluator::mount(item& b, int n) const
+{
+    const auto column = [&](std::size_t k) { return &b.counts[k * rows_per_item]; };
+    b.left.resize(num_parts);
+    for (int r = 0; r < n; r++)
+    {
+        for (unsigned k = 0; k < num_parts; k++)
+            b.left[k] = column(k)[r];
+        const auto count = [&](int i) { return column(num_parts + (unsigned)i)[r]; };
+        int corners = start.sneaky_corners_left;
+        for (std::size_t i = 0; i < terms.size(); i++)
+        {
+            const term& t = terms[i];
+            int* const left = t.file >= 0 ? &b.left[(std::size_t)t.file] : nullptr;
+            int k = INT_MAX;
+            switch (t.rule)
+            {
+            case term::rest: break;
+            case term::constant: k = t.arg; break;
+            case term::hull: k = count(t.arg); break;
+            case term::twice: k = 2 * count(t.arg); break;
+            case term::ammo_big:
+            case term::ammo_small: {
+                const int ammo = -(*params.catalog)[*terms[(std::size_t)t.arg].x].ammo * count(t.arg);
+                k = t.rule == term::ammo_big ? ammo / 2 : ammo % 2;
+                break;
+            }
+            case term::one_leg:
+                if (single_leg_mount(count(d30s_at), count(rd51_at)))
+                    k = 1;
+                break;
+            case term::own_tanks:
+                if (left)
+                    k = *left - sneaky_tanks(corners, *left);
+                break;
+            }
+            if (t.clip)
+            {
+                k = left ? std::min(k, *left) : 0;
+                if (left)
+                    *left -= k;
+            }
+            column(num_parts + i)[r] = k;
+            if (t.x && *t.x == h_cor)
+                corners += k;
+        }
+    }
+}
+
+// the totals of add_part_(), term after term as the loop there would
+// have added them, each for all the rows
+void evaluator::add_up(item& b, int n) const
+{
+    std::fill_n(b.mass, n, start.mass);
+    std::fill_n(b.power, n, start.power);
+    std::fill_n(b.fuel, n, start.fuel);
+    std::fill_n(b.fuel_flow, n, start.fuel_flow);
+    std::fill_n(b.thrust, n, start.thrust);
+    std::fill_n(b.horizontal_thrust, n, start.horizontal_thrust);
+    std::fill_n(b.area, n, start.area);
+    std::fill_n(b.cost, n, start.cost);
+    for (std::size_t i = 0; i < terms.size(); i++)
+    {
+        const term& t = terms[i];
+        if (!t.x)
+        {
+            for (int r = 0; r < n; r++)
+            {
+                b.mass[r] += params.extra_mass;
+                b.power[r] -= params.extra_power;
+            }
+            continue;
+        }
+        const part& x = *t.x;
+        const part_values& v = (*params.catalog)[x];
+        const int* count = &b.counts[(num_parts + i) * rows_per_item];
+        const float fuel = v.fuel >= 0 ? v.fuel : 0, fuel_flow = v.fuel < 0 ? v.fuel : 0;
+        const float horizontal_thrust = x != e_d30s && x != e_rd51 ? v.thrust : 0;
+        const int area = t.amode ? x.area() : 0;
+        for (int r = 0; r < n; r++)
+        {
+            const float c = (float)count[r];
+            b.mass[r] += v.mass * c;
+            b.power[r] += v.power * c;
+            b.fuel[r] += fuel * c;
+            b.fuel_flow[r] -= fuel_flow * c;
+            b.thrust[r] += v.thrust * c;
+            b.horizontal_thrust[r] += horizontal_thrust * c;
+            b.area[r] += count[r] * area;
+            b.cost[r] += v.price * count[r];
+        }
+    }
+}
+
+void evaluator::fill(ship& st, const item& b, int r) const
+{
+    st.mass = b.mass[r];
+    st.power = b.power[r];
+    st.fuel = b.fuel[r];
+    st.fuel_flow = b.fuel_flow[r];
+    st.thrust = b.thrust[r];
+    st.horizontal_thrust = b.horizontal_thrust[r];
+    st.area = b.area[r];
+    st.cost = b.cost[r];
+    st.sneaky_corners_left = start.sneaky_corners_left;
+    std::copy(std::begin(start.footprints), std::end(start.footprints), st.footprints);
+    for (const auto& t : terms)
+        if (t.x)
+            st.parts[t.x->index].second = start.parts[t.x->index].second;
+    for (std::size_t i = 0; i < terms.size(); i++)
+    {
+        const term& t = terms[i];
+        if (!t.x)
+            continue;
+        const int n = b.counts[(num_parts + i) * rows_per_item + (unsigned)r];
+        st.parts[t.x->index].second += n;
+        if (t.amode)
+            st.footprints[t.x->shape()] += n;
+        if (*t.x == h_cor)
+            st.sneaky_corners_left += n;
+    }
+}
+
+void evaluator::evaluate(void* ctx, int i)
+{
+    auto& e = *(evaluator*)ctx;
+    auto& b = *e.items[(std::size_t)i];
+    const int first = i * rows_per_item, n = std::min(rows_per_item, e.num_rows - first);
+    trace_span t{"evaluate"};
+    for (int r = 0; r < n; r++)
+        if (e.records)
+        {
+            e.read_record(b, r, e.records + (std::size_t)(first + r) * e.record_size);
+            b.status[r] = row_out;
+        }
+        else if ((b.status[r] = e.parse_line(b, r, e.lines[first + r])) != row_out)
+            for (unsigned k = 0; k < e.num_counts; k++)
+                b.counts[(std::size_t)k * rows_per_item + (unsigned)r] = 0;
+    e.mount(b, n);
+    e.add_up(b, n);
+    for (int r = 0; r < n; r++)
+        if (b.status[r] == row_out)
+        {
+            e.fill(b.st, b, r);
+            if (b.filter_ship(b.st))
+                b.status[r] = row_in;
+        }
+}
+
+// the rows of the block across threads, then their designs in order
+bool evaluator::run_block()
+{
+    const int num_items = (num_rows + rows_per_item - 1) / rows_per_item;
+    while ((int)items.size() < num_items)
+    {
+        auto& b = *items.emplace_back(std::make_unique<item>());
+        b.counts.resize((std::size_t)num_counts * rows_per_item);
+        b.filter_ship = filter::compile(params);
+        b.st = start;
+    }
+    pool.run(num_items, evaluate, this);
+
+    trace_span t{"report"};
+    ship& st = items[0]->st;
+    for (int i = 0; i < num_items; i++)
+    {
+        const auto& b = *items[(std::size_t)i];
+        for (int r = 0; r < rows_per_item && i * rows_per_item + r < num_rows; r++)
+        {
+            const int row = i * rows_per_item + r;
+            if (b.status[r] == row_bad)
+            {
+                // the header is line 1
+                ERR("%s:%llu: expected %zu comma-separated counts", name,
+                    (unsigned long long)(first_row + (unsigned)row + 2), columns.size());
+                terminate(EX_DATAERR);
+            }
+            if (b.status[r] != row_in)
+                continue;
+            if (control.num_designs >= params.num_matches)
+                return false;
+            fill(st, b, r);
+            st.seq = first_row + (unsigned)row;
+            report_design(control, st, params);
+        }
+    }
+    first_row += (unsigned)num_rows;
+    control.searched.store(first_row, std::memory_order_relaxed);
+    control.designs.store(control.num_designs, std::memory_order_relaxed);
+    return control.num_designs < params.num_matches;
+}
+
+// whole lines, a chunk of the file at a time. 'head' was read already.
+void evaluator::run_text(std::string head)
+{
+    std::vector<char> buf(head.begin(), head.end());
+    std::vector<line_span> spans;
+    bool eof = false, has_header = false;
+    while (!eof || !buf.empty())
+    {
+        if (!eof)
+        {
+            trace_span t{"read"};
+            const std::size_t size = buf.size();
+            buf.resize(size + text_chunk);
+            const std::size_t n = fread(buf.data() + size, 1, text_chunk, in);
+            buf.resize(size + n);
+            if (n < text_chunk)
+            {
+                if (ferror(in))
+                {
+                    ERR("%s: %s", name, strerror(errno));
+                    terminate(EX_IOERR);
+                }
+                eof = true;
+            }
+        }
+        const char* const data = buf.data();
+        std::size_t end = buf.size();
+        if (!eof)
+        {
+            while (end > 0 && data[end - 1] != '\n')
+                end--;
+            if (!end)
+                continue; // a line longer than the chunk
+        }
+
+        spans.clear();
+        for (const char* s = data; s < data + end; )
+        {
+            const char* nl = (const char*)memchr(s, '\n', (std::size_t)(data + end - s));
+            const char* e = nl ? nl : data + end;
+            spans.push_back({ s, e });
+            s = e + 1;
+        }
+        std::size_t first = 0;
+        if (!has_header && !spans.empty())
+        {
+            parse_header(spans[0]);
+            has_header = true;
+            first = 1;
+        }
+        // at most a block of them at once
+        for (std::size_t n; first < spans.size(); first += n)
+        {
+            n = std::min(spans.size() - first, (std::size_t)max_items * rows_per_item);
+            lines = &spans[first];
+            num_rows = (int)n;
+            if (!run_block())
+                return;
+        }
+        buf.erase(buf.begin(), buf.begin() + (std::ptrdiff_t)end);
+    }
+    if (!has_header)
+    {
+        ERR("%s: no header", name);
+        terminate(EX_DATAERR);
+    }
+}
+
+void evaluator::run_records()
+{
+    record_reader reader;
+    if (!reader.open(in, name, true))
+        terminate(EX_DATAERR);
+    map_columns(reader.header.part_names);
+    record_size = reader.header.record_size();
+    counts_at = record_size - 2 * reader.header.part_names.size();
+
+    std::vector<unsigned char> buf(record_size * max_items * rows_per_item);
+    records = buf.data();
+    for (;;)
+    {
+        std::size_t n;
+        {
+            trace_span t{"read"};
+            n = fread(buf.data(), 1, buf.size(), in);
+        }
+        if (n % record_size)
+        {
+            ERR("%s: truncated record", name);
+            terminate(EX_DATAERR);
+        }
+        if (!n)
+            break;
+        num_rows = (int)(n / record_size);
+        if (!run_block() || n < buf.size())
+            break;
+    }
+    if (ferror(in))
+    {
+        ERR("%s: %s", name, strerror(errno));
+        terminate(EX_IOERR);
+    }
+}
+
+void evaluator::run()
+{
+    char magic[sizeof(record_header::magic)];
+    const std::size_t n = fread(magic, 1, sizeof(magic), in);
+    if (n == sizeof(magic) && !memcmp(magic, record_header::magic, sizeof(magic)))
+        run_records();
+    else
+        run_text({ magic, n });
+}
+
+} // namespace
+
+void evaluate_designs(const ship& base, const cmdline& params, search_control& control)
+{
+    evaluator{base, params, control}.run();
+}
+
+} // namespace hf::design
@@ -0,0 +1,19 @@
+#pragma once
+
+namespace hf::design {
+
+struct ship;
+struct cmdline;
+struct search_control;
+
+// --eval: designs read from a file, or - for stdin, rather than searched
+// for. csv with part names or hf-design's headers and a design's counts on
+// each line, or the records of -F bin. every design is added up as
+// ship::add_part_() would, a block of them at a time and across threads,
+// then filtered and reported in file order like the search's. a csv naming
+// no hulls starts from 'base', the bridge and guns of the command line, and
+// gets -x extinguishers and the hulls of its parts added, a hull a part;
+// records and csv with hull columns have them all already.
+void evaluate_designs(const ship& base, const cmdline& params, search_control& control);
+
+} // namespace hf::design
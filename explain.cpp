@@ -0,0 +1,163 @@
+#include "explain.hpp"
+#include "cmdline.hpp"
+#include "part.hpp"
+#include "part-list.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <tuple>
+
+namespace hf::design {
+
+namespace {
+
+constexpr double float_max = std::numeric_limits<float>::max();
+
+near_misses::limit make_limit(metric m, double lo, double hi, double max)
+{
+    near_misses::limit x{};
+    x.m = m;
+    x.lo = lo;
+    x.hi = hi;
+    x.has_lo = lo > 1e-6; // the metrics can't go below 0 anyway
+    x.has_hi = hi < max;
+    x.closest = x.closest_alone = HUGE_VAL;
+    return x;
+}
+
+// how far outside, relative to the bound it misses
+double violation(const near_misses::limit& x, double value)
+{
+    if (std::isnan(value))
+        return HUGE_VAL;
+    if (x.has_lo && value < x.lo)
+        return (x.lo - value) / x.lo;
+    if (x.has_hi && value > x.hi)
+        return (value - x.hi) / std::max(std::fabs(x.hi), 1e-6);
+    return 0;
+}
+
+void print_bounds(const near_misses::limit& x)
+{
+    const char* name = metric_info_of(x.m).name;
+    if (x.has_lo && x.has_hi)
+        fprintf(stderr, "  %s within %g..%g", name, x.lo, x.hi);
+    else if (x.has_lo)
+        fprintf(stderr, "  %s >= %g", name, x.lo);
+    else
+        fprintf(stderr, "  %s <= %g", name, x.hi);
+}
+
+} // namespace
+
+near_misses::near_misses(const cmdline& params) :
+    limits{
+        make_limit(metric::twr, (double)params.twr.min, (double)params.twr.max, float_max),
+        make_limit(metric::cost, params.cost.min, params.cost.max, cmdline::int_max),
+        make_limit(metric::fuel_usage, (double)params.fuel_usage.min, (double)params.fuel_usage.max, float_max),
+        make_limit(metric::horizontal_twr, (double)params.horizontal_twr.min, (double)params.horizontal_twr.max, float_max),
+    }
+{
+}
+
+void near_misses::push(const ship& st)
+{
+    double v[num_limits], total = 0;
+    int missed = 0, last = 0;
+    built++;
+    for (int i = 0; i < num_limits; i++)
+        if ((v[i] = violation(limits[i], metric_value(st, limits[i].m))) > 0)
+        {
+            total += v[i];
+            missed++;
+            last = i;
+        }
+    if (!missed)
+    {
+        within++;
+        return;
+    }
+
+    for (int i = 0; i < num_limits; i++)
+    {
+        auto& x = limits[i];
+        if (!(v[i] > 0))
+            continue;
+        x.failed++;
+        if (v[i] < x.closest)
+        {
+            x.closest = v[i];
+            x.value = metric_value(st, x.m);
+        }
+    }
+    if (missed == 1)
+    {
+        auto& x = limits[last];
+        x.failed_alone++;
+        if (v[last] < x.closest_alone)
+        {
+            x.closest_alone = v[last];
+            x.value_alone = metric_value(st, x.m);
+        }
+    }
+
+    // closest first, earlier ones win ties
+    if (num_misses == max_misses && !(total < miss_violation[max_misses - 1]))
+        return;
+    int i = num_misses < max_misses ? num_misses++ : max_misses - 1;
+    for (; i > 0 && total < miss_violation[i - 1]; i--)
+    {
+        misses[i] = misses[i - 1];
+        miss_violation[i] = miss_violation[i - 1];
+    }
+    misses[i] = st;
+    miss_violation[i] = total;
+}
+
+void near_misses::print() const
+{
+    const std::tuple<const char*, const part&> engine_parts[] = {
+        { "d30s",   e_d30s  },
+        { "d30",    e_d30   },
+        { "nk25",   e_nk25  },
+        { "rd51",   e_rd51  },
+        { "rd59",   e_rd59  },
+    };
+
+    fprintf(stderr, "explain: %llu designs built, %llu within every limit below\n",
+            (unsigned long long)built, (unsigned long long)within);
+    for (const auto& x : limits)
+    {
+        if (!x.failed)
+            continue;
+        print_bounds(x);
+        fprintf(stderr, ": missed by %llu, closest %g (%.3g%% off)",
+                (unsigned long long)x.failed, x.value, 100 * x.closest);
+        if (x.failed_alone)
+            fprintf(stderr, "; binding for %llu, closest %g (%.3g%% off)",
+                    (unsigned long long)x.failed_alone, x.value_alone, 100 * x.closest_alone);
+        fprintf(stderr, "\n");
+    }
+    if (within)
+        fprintf(stderr, "  the rest is up to -E, --where, --layout, --mission or --duel\n");
+
+    if (num_misses)
+        fprintf(stderr, "explain: nearest misses\n");
+    for (int i = 0; i < num_misses; i++)
+    {
+        const auto& st = misses[i];
+        fprintf(stderr, "  %.3g%% off:", 100 * miss_violation[i]);
+        for (const auto& x : limits)
+            if (x.has_lo || x.has_hi)
+                fprintf(stderr, " %s %g", metric_info_of(x.m).name, metric_value(st, x.m));
+        fprintf(stderr, " |");
+        for (const auto& [name, x] : engine_parts)
+            if (int cnt = st.count(x); cnt)
+                fprintf(stderr, " %s:%d", name, cnt);
+        fprintf(stderr, " tank:%d,%d\n", st.count(tank_1x2), st.count(tank_4x4));
+    }
+    fflush(stderr);
+}
+
+} // namespace hf::design
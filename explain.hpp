@@ -0,0 +1,44 @@
+#pragma once
+#include "metric.hpp"
+#include "ship.hpp"
+#include <cmath>
+#include <cstdint>
+
+namespace hf::design {
+
+struct cmdline;
+
+// --explain: how close the designs of a search came to the intervals of
+// the query (-T, -H, -u, -c). every design built is pushed before it's
+// filtered; that's a handful of compares and no allocation unless it's
+// one of the closest so far. violations are relative to the bound.
+struct near_misses final
+{
+    static constexpr int num_limits = 4;
+    static constexpr int max_misses = 3; // listed closest overall
+
+    struct limit final
+    {
+        metric m;
+        double lo, hi;
+        bool has_lo, has_hi;
+        std::uint64_t failed = 0, failed_alone = 0; // alone: it's the only one missed
+        double closest = HUGE_VAL, closest_alone = HUGE_VAL; // least violation
+        double value = 0, value_alone = 0;            // the metric there
+    };
+
+    explicit near_misses(const cmdline& params);
+
+    void push(const ship& st);
+    // to stderr, after the search came up empty
+    void print() const;
+
+private:
+    limit limits[num_limits];
+    std::uint64_t built = 0, within = 0;
+    ship misses[max_misses];
+    double miss_violation[max_misses];
+    int num_misses = 0;
+};
+
+} // namespace hf::design
@@ -0,0 +1,466 @@
+#include "filter.hpp"
+#include "cmdline.hpp"
+#include "part.hpp"
+#include "part-list.hpp"
+#include "defs.hpp"
+#include "log.hpp"
+
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+namespace hf::design {
+
+namespace {
+
+struct expr final
+{
+    enum type_ : unsigned char { number, boolean };
+    enum kind_ : unsigned char { constant, metric_, count, unary, binary, compare, all, any, negate, within };
+
+    kind_ kind;
+    char op = 0;
+    filter::rel relation = filter::rel::eq;
+    double value = 0, lo = 0, hi = 0;
+    unsigned arg = 0;
+    std::vector<expr> args;
+
+    type_ type() const
+    {
+        switch (kind)
+        {
+        case compare: case all: case any: case negate: case within: return boolean;
+        default: return number;
+        }
+    }
+};
+
+} // namespace
+
+struct filter_compiler final
+{
+    const cmdline& params;
+    const char* str;
+    const char* pos;
+    filter f;
+
+    [[noreturn]] void fail(const char* msg) const;
+    void skip_ws() { while (*pos && isspace((unsigned char)*pos)) pos++; }
+    bool accept(const char* tok);
+    const expr& need(const expr& e, expr::type_ t) const;
+
+    expr parse_or();
+    expr parse_and();
+    expr parse_not();
+    expr parse_compare();
+    expr parse_sum();
+    expr parse_product();
+    expr parse_unary();
+    expr parse_atom();
+
+    static metric_info::stage_ stage_of(const expr& e);
+    unsigned emit_code(const expr& e);
+    unsigned short emit(const expr& e);
+    float cost_of(const expr& e) const;
+};
+
+void filter_compiler::fail(const char* msg) const
+{
+    ERR("--where: %s at '%s' in '%s'", msg, *pos ? pos : "<end>", str);
+    params.seek_help();
+    terminate(EX_USAGE);
+}
+
+bool filter_compiler::accept(const char* tok)
+{
+    skip_ws();
+    std::size_t len = strlen(tok);
+    if (strncmp(pos, tok, len))
+        return false;
+    // don't take '<' out of '<=' or '|' out of '||'
+    if (len == 1 && pos[1] && strchr("=&|", pos[1]) && strchr("<>=!&|", *pos))
+        return false;
+    pos += len;
+    return true;
+}
+
+const expr& filter_compiler::need(const expr& e, expr::type_ t) const
+{
+    if (e.type() != t)
+        fail(t == expr::boolean ? "expected a comparison" : "expected a number");
+    return e;
+}
+
+expr filter_compiler::parse_or()
+{
+    expr e = parse_and();
+    if (!accept("||"))
+        return e;
+    expr ret{expr::any};
+    ret.args.push_back(need(e, expr::boolean));
+    do
+        ret.args.push_back(need(parse_and(), expr::boolean));
+    while (accept("||"));
+    return ret;
+}
+
+expr filter_compiler::parse_and()
+{
+    expr e = parse_not();
+    if (!accept("&&"))
+        return e;
+    expr ret{expr::all};
+    ret.args.push_back(need(e, expr::boolean));
+    do
+        ret.args.push_back(need(parse_not(), expr::boolean));
+    while (accept("&&"));
+    return ret;
+}
+
+expr filter_compiler::parse_not()
+{
+    if (accept("!"))
+    {
+        expr ret{expr::negate};
+        ret.args.push_back(need(parse_not(), expr::boolean));
+        return ret;
+    }
+    return parse_compare();
+}
+
+expr filter_compiler::parse_compare()
+{
+    constexpr std::pair<const char*, filter::rel> rels[] = {
+        { "<=", filter::rel::le }, { ">=", filter::rel::ge },
+        { "==", filter::rel::eq }, { "!=", filter::rel::ne },
+        { "<",  filter::rel::lt }, { ">",  filter::rel::gt },
+    };
+    expr lhs = parse_sum();
+    for (const auto& [tok, r] : rels)
+        if (accept(tok))
+        {
+            expr ret{expr::compare};
+            ret.relation = r;
+            ret.args.push_back(need(lhs, expr::number));
+            ret.args.push_back(need(parse_sum(), expr::number));
+            return ret;
+        }
+    return lhs;
+}
+
+expr filter_compiler::parse_sum()
+{
+    expr e = parse_product();
+    for (;;)
+    {
+        char op = accept("+") ? '+' : accept("-") ? '-' : 0;
+        if (!op)
+            return e;
+        expr ret{expr::binary};
+        ret.op = op;
+        ret.args.push_back(need(e, expr::number));
+        ret.args.push_back(need(parse_product(), expr::number));
+        e = std::move(ret);
+    }
+}
+
+expr filter_compiler::parse_product()
+{
+    expr e = parse_unary();
+    for (;;)
+    {
+        char op = accept("*") ? '*' : accept("/") ? '/' : accept("%") ? '%' : 0;
+        if (!op)
+            return e;
+        expr ret{expr::binary};
+        ret.op = op;
+        ret.args.push_back(need(e, expr::number));
+        skip_ws();
+        const char* rhs = pos;
+        ret.args.push_back(need(parse_unary(), expr::number));
+        // a constant divisor below 1 is a mistake, a variable one gives nan
+        if (const expr& d = ret.args[1];
+            op == '%' && (d.kind == expr::constant || (d.kind == expr::unary && d.args[0].kind == expr::constant)) &&
+            (long long)(d.kind == expr::constant ? d.value : -d.args[0].value) < 1)
+        {
+            pos = rhs;
+            fail("% needs a divisor of 1 or more");
+        }
+        e = std::move(ret);
+    }
+}
+
+expr filter_compiler::parse_unary()
+{
+    if (accept("-"))
+    {
+        expr ret{expr::unary};
+        ret.op = '-';
+        ret.args.push_back(need(parse_unary(), expr::number));
+        return ret;
+    }
+    return parse_atom();
+}
+
+expr filter_compiler::parse_atom()
+{
+    skip_ws();
+    if (accept("("))
+    {
+        expr e = parse_or();
+        if (!accept(")"))
+            fail("expected ')'");
+        return e;
+    }
+    if (isdigit((unsigned char)*pos) || *pos == '.')
+    {
+        char* end;
+        expr e{expr::constant};
+        e.value = std::strtod(pos, &end);
+        if (end == pos)
+            fail("bad number");
+        pos = end;
+        return e;
+    }
+    if (isalpha((unsigned char)*pos) || *pos == '_')
+    {
+        const char* start = pos;
+        while (isalnum((unsigned char)*pos) || *pos == '_')
+            pos++;
+        auto len = (std::size_t)(pos - start);
+        if (const auto* m = find_metric(start, len))
+        {
+            expr e{expr::metric_};
+            e.arg = (unsigned)m->id;
+            return e;
+        }
+        char buf[64];
+        if (len < sizeof(buf))
+        {
+            memcpy(buf, start, len);
+            buf[len] = '\0';
+            if (const auto& p = part::find_part(buf); p != null_part)
+            {
+                expr e{expr::count};
+                e.arg = p.index;
+                return e;
+            }
+        }
+        pos = start;
+        fail("unknown metric or part name");
+    }
+    fail("syntax error");
+}
+
+unsigned filter_compiler::emit_code(const expr& e)
+{
+    auto& code = f.code;
+    switch (e.kind)
+    {
+    case expr::constant:
+        f.constants.push_back(e.value);
+        code.push_back({ filter::op::constant, (unsigned short)(f.constants.size() - 1) });
+        return 1;
+    case expr::metric_:
+        code.push_back({ filter::op::metric, (unsigned short)e.arg });
+        return 1;
+    case expr::count:
+        code.push_back({ filter::op::count, (unsigned short)e.arg });
+        return 1;
+    case expr::unary: {
+        unsigned depth = emit_code(e.args[0]);
+        code.push_back({ filter::op::neg, 0 });
+        return depth;
+    }
+    case expr::binary: {
+        unsigned a = emit_code(e.args[0]), b = emit_code(e.args[1]);
+        filter::op op;
+        switch (e.op)
+        {
+        case '+': op = filter::op::add; break;
+        case '-': op = filter::op::sub; break;
+        case '*': op = filter::op::mul; break;
+        case '/': op = filter::op::div; break;
+        default:  op = filter::op::mod; break;
+        }
+        code.push_back({ op, 0 });
+        unsigned depth = std::max(a, b + 1);
+        if (depth > filter::max_depth)
+            fail("expression too deep");
+        return depth;
+    }
+    default:
+        break;
+    }
+    ABORT("emit_code() on a boolean node");
+    return 0;
+}
+
+metric_info::stage_ filter_compiler::stage_of(const expr& e)
+{
+    auto ret = e.kind == expr::metric_ ? metric_info_of((metric)e.arg).stage : metric_info::build;
+    for (const auto& x : e.args)
+        ret = std::max(ret, stage_of(x));
+    return ret;
+}
+
+float filter_compiler::cost_of(const expr& e) const
+{
+    float ret = 0;
+    switch (e.kind)
+    {
+    case expr::metric_: ret = metric_info_of((metric)e.arg).cost; break;
+    case expr::constant: break;
+    default: ret = 1; break;
+    }
+    for (const auto& x : e.args)
+        ret += cost_of(x);
+    return ret;
+}
+
+unsigned short filter_compiler::emit(const expr& e)
+{
+    filter::node n{};
+    n.cost = cost_of(e);
+
+    switch (e.kind)
+    {
+    case expr::all:
+    case expr::any:
+    case expr::negate: {
+        n.type = e.kind == expr::all ? filter::kind::all
+               : e.kind == expr::any ? filter::kind::any
+                                     : filter::kind::negate;
+        std::vector<unsigned short> kids;
+        for (const auto& x : e.args)
+            // a && (b && c) is one node with three children
+            if (x.kind == e.kind && e.kind != expr::negate)
+                for (const auto& y : x.args)
+                    kids.push_back(emit(y));
+            else
+                kids.push_back(emit(x));
+        n.first = (unsigned short)f.children.size();
+        n.count = (unsigned short)kids.size();
+        f.children.insert(f.children.end(), kids.begin(), kids.end());
+        break;
+    }
+    case expr::within:
+        n.type = filter::kind::within;
+        n.lo = e.lo; n.hi = e.hi;
+        n.first = (unsigned short)f.code.size();
+        emit_code(e.args[0]);
+        n.count = (unsigned short)(f.code.size() - n.first);
+        break;
+    case expr::compare:
+        n.type = filter::kind::compare;
+        n.relation = e.relation;
+        n.first = (unsigned short)f.code.size();
+        emit_code(e.args[0]);
+        n.count = (unsigned short)(f.code.size() - n.first);
+        n.rhs_first = (unsigned short)f.code.size();
+        emit_code(e.args[1]);
+        n.rhs_count = (unsigned short)(f.code.size() - n.rhs_first);
+        break;
+    default:
+        ABORT("emit() on a number node");
+    }
+
+    if (f.nodes.size() >= (1 << 16) - 1 || f.code.size() >= (1 << 16) - 1)
+        fail("expression too long");
+    f.nodes.push_back(n);
+    return (unsigned short)(f.nodes.size() - 1);
+}
+
+filter filter::compile(const cmdline& params, metric_info::stage_ stage)
+{
+    filter_compiler c{params, params.where, params.where ? params.where : "", {}};
+
+    auto metric_of = [](metric m) { expr e{expr::metric_}; e.arg = (unsigned)m; return e; };
+    auto count_of = [](const part& p) { expr e{expr::count}; e.arg = p.index; return e; };
+    auto within = [&](metric m, double lo, double hi) {
+        expr e{expr::within};
+        e.lo = lo; e.hi = hi;
+        e.args.push_back(metric_of(m));
+        return e;
+    };
+
+    expr root{expr::all}, bound{expr::all};
+
+    if (params.engine_parity != cmdline::parity::any)
+    {
+        expr sum{expr::binary}, mod{expr::binary}, two{expr::constant}, zero{expr::constant}, cmp{expr::compare};
+        sum.op = '+';
+        sum.args = { count_of(e_d30), count_of(e_nk25) };
+        two.value = 2;
+        mod.op = '%';
+        mod.args = { std::move(sum), two };
+        cmp.relation = params.engine_parity == cmdline::parity::even ? rel::eq : rel::ne;
+        cmp.args = { std::move(mod), zero };
+        root.args.push_back(cmp);
+        bound.args.push_back(std::move(cmp));
+    }
+
+    root.args.push_back(within(metric::twr, (double)params.twr.min, (double)params.twr.max));
+    root.args.push_back(within(metric::cost, params.cost.min, params.cost.max));
+    root.args.push_back(within(metric::fuel_usage, (double)params.fuel_usage.min, (double)params.fuel_usage.max));
+    root.args.push_back(within(metric::horizontal_twr, (double)params.horizontal_twr.min, (double)params.horizontal_twr.max));
+    bound.args.push_back(within(metric::twr, (double)params.twr.min, HUGE_VAL));
+    bound.args.push_back(within(metric::cost, -HUGE_VAL, params.cost.max));
+    bound.args.push_back(within(metric::horizontal_twr, (double)params.horizontal_twr.min, HUGE_VAL));
+
+    if (params.where)
+    {
+        expr e = c.parse_or();
+        c.skip_ws();
+        if (*c.pos)
+            c.fail("trailing garbage");
+        c.need(e, expr::boolean);
+        // split a top-level conjunction so its early parts can run early
+        if (e.kind == expr::all)
+            for (auto& x : e.args)
+                root.args.push_back(std::move(x));
+        else
+            root.args.push_back(std::move(e));
+    }
+
+    auto& args = root.args;
+    args.erase(std::remove_if(args.begin(), args.end(),
+                              [&](const expr& x) { return filter_compiler::stage_of(x) != stage; }),
+               args.end());
+    if (stage != metric_info::build)
+        bound.args.clear();
+
+    c.f.bound_root = c.emit(bound);
+    c.f.root = c.emit(root);
+    return std::move(c.f);
+}
+
+void filter::reorder(node& n)
+{
+    // for independent checks, the expected work of a conjunction is least
+    // when ordered by cost over rejection rate, and dually for disjunctions.
+    bool conj = n.type == kind::all;
+    auto key = [&](unsigned short idx) {
+        const node& x = nodes[idx];
+        float rate = x.evals ? (float)x.passes / (float)x.evals : .5f;
+        if (conj)
+            rate = 1 - rate;
+        return x.cost / std::max(rate, 1e-3f);
+    };
+    auto begin = children.begin() + n.first, end = begin + n.count;
+    std::stable_sort(begin, end, [&](auto a, auto b) { return key(a) < key(b); });
+
+    // halve the counts so the order keeps up as the search moves around
+    for (auto it = begin; it != end; it++)
+    {
+        node& x = nodes[*it];
+        x.evals /= 2;
+        x.passes /= 2;
+    }
+}
+
+} // namespace hf::design
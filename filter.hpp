@@ -0,0 +1,165 @@
+#pragma once
+#include "metric.hpp"
+#include "ship.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace hf::design {
+
+struct cmdline;
+
+// predicate over a finished ship: the built-in constraints and --where,
+// compiled once into a flat node tree whose leaves run small postfix
+// programs. every and/or node keeps pass counts for its children and
+// periodically sorts them so the cheapest, most decisive check runs first.
+
+struct filter final
+{
+    enum class op : unsigned char { constant, metric, count, add, sub, mul, div, mod, neg };
+    enum class kind : unsigned char { all, any, negate, compare, within };
+    enum class rel : unsigned char { lt, le, gt, ge, eq, ne };
+
+    struct insn final
+    {
+        op code;
+        unsigned short arg; // constant slot, metric or part index
+    };
+
+    struct node final
+    {
+        kind type;
+        rel relation = rel::eq;
+        unsigned short first = 0, count = 0;        // children, or lhs code
+        unsigned short rhs_first = 0, rhs_count = 0;
+        double lo = 0, hi = 0;
+        float cost = 0;
+        unsigned evals = 0, passes = 0;
+    };
+
+    static constexpr unsigned max_depth = 32;
+    static constexpr unsigned reorder_interval = 4096;
+
+    // only the checks that can run once 'stage' has been computed
+    static filter compile(const cmdline& params, metric_info::stage_ stage = metric_info::build);
+    bool operator()(const ship& st) { return eval(root, st); }
+    // the checks more mass and cost can only make a ship fail, the -T and
+    // -H minimums, the most it may cost and engine parity. true for those
+    // of a later stage.
+    bool bound(const ship& st) { return eval(bound_root, st); }
+    bool empty() const { return nodes[root].count == 0; }
+
+private:
+    double load(insn x, const ship& st) const;
+    double run(unsigned first, unsigned count, const ship& st) const;
+    bool eval(unsigned idx, const ship& st);
+    void reorder(node& n);
+
+    std::vector<node> nodes;
+    std::vector<unsigned short> children;
+    std::vector<insn> code;
+    std::vector<double> constants;
+    unsigned root = 0, bound_root = 0;
+
+    friend struct filter_compiler;
+};
+
+inline double filter::load(insn x, const ship& st) const
+{
+    switch (x.code)
+    {
+    case op::constant: return constants[x.arg];
+    case op::metric:   return metric_value(st, (metric)x.arg);
+    case op::count:    return st.parts[x.arg].second;
+    default:           return 0;
+    }
+}
+
+inline double filter::run(unsigned first, unsigned count, const ship& st) const
+{
+    if (count == 1) // most leaves compare a single metric to a constant
+        return load(code[first], st);
+
+    double stack[max_depth];
+    unsigned sp = 0;
+
+    for (unsigned i = first; i < first + count; i++)
+    {
+        auto [c, arg] = code[i];
+        switch (c)
+        {
+        case op::constant:
+        case op::metric:
+        case op::count:    stack[sp++] = load(code[i], st); break;
+        case op::neg:      stack[sp-1] = -stack[sp-1]; break;
+        case op::add:      sp--; stack[sp-1] += stack[sp]; break;
+        case op::sub:      sp--; stack[sp-1] -= stack[sp]; break;
+        case op::mul:      sp--; stack[sp-1] *= stack[sp]; break;
+        case op::div:      sp--; stack[sp-1] /= stack[sp]; break;
+        case op::mod:
+            sp--;
+            stack[sp-1] = (long long)stack[sp] < 1 ? NAN : (double)((long long)stack[sp-1] % (long long)stack[sp]);
+            break;
+        }
+    }
+    return stack[0];
+}
+
+inline bool filter::eval(unsigned idx, const ship& st)
+{
+    node& n = nodes[idx];
+    bool ret;
+
+    switch (n.type)
+    {
+    case kind::all:
+        ret = true;
+        for (unsigned i = n.first; i < n.first + n.count; i++)
+            if (!eval(children[i], st))
+            {
+                ret = false;
+                break;
+            }
+        break;
+    case kind::any:
+        ret = false;
+        for (unsigned i = n.first; i < n.first + n.count; i++)
+            if (eval(children[i], st))
+            {
+                ret = true;
+                break;
+            }
+        break;
+    case kind::negate:
+        ret = !eval(children[n.first], st);
+        break;
+    case kind::within: {
+        double x = run(n.first, n.count, st);
+        ret = x >= n.lo && x <= n.hi;
+        break;
+    }
+    default:
+    case kind::compare: {
+        double a = run(n.first, n.count, st), b = run(n.rhs_first, n.rhs_count, st);
+        switch (n.relation)
+        {
+        case rel::lt: ret = a < b; break;
+        case rel::le: ret = a <= b; break;
+        case rel::gt: ret = a > b; break;
+        case rel::ge: ret = a >= b; break;
+        case rel::eq: ret = a == b; break;
+        default:
+        case rel::ne: ret = a < b || a > b; break; // false for nan, as the rest are
+        }
+        break;
+    }
+    }
+
+    n.passes += ret;
+    if (++n.evals % reorder_interval == 0 && n.count > 1 &&
+        (n.type == kind::all || n.type == kind::any))
+        reorder(n);
+    return ret;
+}
+
+} // namespace hf::design
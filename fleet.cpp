@@ -0,0 +1,380 @@
+#include "fleet.hpp"
+#include "search.hpp"
+#include "space.hpp"
+#include "record.hpp"
+#include "report.hpp"
+#include "cmdline.hpp"
+#include "part.hpp"
+#include "ship.hpp"
+#include "trace.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace hf::design {
+
+namespace {
+
+using option = fleet_pool::option;
+
+// the mass and slack of what a sweep by cost has kept so far, less those
+// a lighter one has as much slack as: the heavier a step, the more slack.
+// whether any of them beats the next one is then a single lookup.
+struct staircase final
+{
+    std::vector<std::pair<double, double>> steps; // mass and slack, by mass
+
+    bool beats(double mass, double slack) const
+    {
+        const auto it = std::upper_bound(steps.begin(), steps.end(), mass,
+                                         [](double m, const auto& x) { return m < x.first; });
+        return it != steps.begin() && it[-1].second >= slack;
+    }
+
+    // a mass and slack it doesn't beat
+    void insert(double mass, double slack)
+    {
+        auto first = std::lower_bound(steps.begin(), steps.end(), mass,
+                                      [](const auto& x, double m) { return x.first < m; });
+        auto last = first;
+        while (last != steps.end() && last->second <= slack)
+            last++;
+        if (first == last)
+            steps.insert(first, { mass, slack });
+        else
+        {
+            *first = { mass, slack };
+            steps.erase(first + 1, last);
+        }
+    }
+};
+
+// drops the options of [first, end) that another one of them beats or
+// equals in cost, mass and slack. they all have the same guns.
+void prune(std::vector<option>& options, std::size_t first)
+{
+    const auto begin = options.begin() + (std::ptrdiff_t)first;
+    std::stable_sort(begin, options.end(), [](const option& a, const option& b) {
+        if (a.cost != b.cost)
+            return a.cost < b.cost;
+        if (a.mass != b.mass)
+            return a.mass < b.mass;
+        return a.slack > b.slack;
+    });
+    staircase kept_by_mass;
+    auto kept = begin;
+    for (auto it = begin; it != options.end(); it++)
+        if (!kept_by_mass.beats(it->mass, it->slack))
+        {
+            kept_by_mass.insert(it->mass, it->slack);
+            *kept++ = *it;
+        }
+    options.erase(kept, options.end());
+}
+
+// a fleet, as one ship added to a smaller fleet
+struct fleet final
+{
+    std::int64_t cost = 0;
+    double mass = 0, thrust = 0, slack = 0;
+    int guns = 0, ships = 0;
+    int smaller = -1;    // into the solver's fleets
+    unsigned option = 0; // the ship added
+
+    bool operator<(const fleet& x) const
+    {
+        if (guns != x.guns)
+            return guns > x.guns;
+        if (cost != x.cost)
+            return cost < x.cost;
+        return mass < x.mass;
+    }
+
+    // whatever ships are added to both, this one comes out ahead. without
+    // a mass limit, mass only matters between fleets that cost the same.
+    bool beats(const fleet& x, bool by_mass) const
+    {
+        return cost <= x.cost && slack >= x.slack && (mass <= x.mass || (!by_mass && cost < x.cost));
+    }
+};
+
+// a dynamic program over pareto fronts. for each number of ships and
+// guns only the fleets that no other one beats are kept, and each option
+// in turn joins every fleet as often as there's room left. that's exact,
+// and the fronts stay small as designs of a loadout are much alike. with
+// a mass limit they're fronts of three things and grow to thousands, so
+// an option joins a whole front at once and the fleets it makes are
+// merged in by one sweep.
+struct fleet_solver final
+{
+    const std::vector<option>& options;
+    const fleet_limits& limits;
+    const int max_guns;
+    const bool by_mass = limits.mass < std::numeric_limits<double>::max();
+    std::vector<fleet> fleets;         // ever kept, the fronts point here
+    std::vector<std::vector<int>> fronts; // by ships and guns, cheapest first
+    std::vector<double> slack;         // most slack from here on
+    std::vector<fleet> batch;          // an option joining a front
+    std::vector<int> merged;
+    staircase kept;
+
+    fleet_solver(const std::vector<option>& options, const fleet_limits& limits) :
+        options{options}, limits{limits}, max_guns{limits.ships * max_guns_of(options)},
+        fronts((std::size_t)((limits.ships + 1) * (max_guns + 1))),
+        slack(options.size() + 1, -HUGE_VAL)
+    {
+        for (std::size_t i = options.size(); i-- > 0; )
+            slack[i] = std::max(slack[i + 1], options[i].slack);
+    }
+
+    static int max_guns_of(const std::vector<option>& options)
+    {
+        int n = 0;
+        for (const auto& x : options)
+            n = std::max(n, x.guns);
+        return n;
+    }
+
+    std::vector<int>& front(int ships, int guns)
+    {
+        return fronts[(std::size_t)(ships * (max_guns + 1) + guns)];
+    }
+
+    // the fleets of 'batch' into the front 'v', as adding them one at a
+    // time would. both are in order of cost, then mass, then the most
+    // slack, so the sweep comes to a fleet after all that could beat it,
+    // and the front stays in that order.
+    void merge(std::vector<int>& v)
+    {
+        const auto before = [](const fleet& a, const fleet& b) {
+            if (a.cost != b.cost)
+                return a.cost < b.cost;
+            if (a.mass != b.mass)
+                return a.mass < b.mass;
+            return a.slack > b.slack;
+        };
+        merged.clear();
+        kept.steps.clear();
+        for (std::size_t a = 0, b = 0; a < v.size() || b < batch.size(); )
+        {
+            // on a tie the front keeps what it had
+            const bool old = b == batch.size() || (a < v.size() && !before(batch[b], fleets[(std::size_t)v[a]]));
+            const fleet& f = old ? fleets[(std::size_t)v[a++]] : batch[b++];
+            if (kept.beats(f.mass, f.slack))
+                continue;
+            kept.insert(f.mass, f.slack);
+            if (old)
+                merged.push_back(v[a - 1]);
+            else
+            {
+                merged.push_back((int)fleets.size());
+                fleets.push_back(f);
+            }
+        }
+        v.swap(merged);
+    }
+
+    // without a mass limit a fleet with more slack never costs less, or
+    // it'd beat the other one. so a front sorted by slack is sorted by
+    // cost too, and what beats or gets beaten sits next to 'f'.
+    void add_by_slack(std::vector<int>& v, const fleet& f)
+    {
+        const auto at = [this](int i) -> const fleet& { return fleets[(std::size_t)i]; };
+        const auto less_slack = [&](int i, double x) { return at(i).slack < x; };
+        for (auto it = std::lower_bound(v.begin(), v.end(), f.slack, less_slack);
+             it != v.end() && at(*it).cost <= f.cost; it++)
+            if (at(*it).beats(f, false))
+                return;
+        auto last = std::upper_bound(v.begin(), v.end(), f.slack, [&](double x, int i) { return x < at(i).slack; });
+        auto first = last;
+        while (first != v.begin() && at(first[-1]).cost >= f.cost)
+            first--;
+        last = v.erase(std::remove_if(first, last, [&](int i) { return f.beats(at(i), false); }), last);
+        v.insert(std::lower_bound(v.begin(), last, f.slack, less_slack), (int)fleets.size());
+        fleets.push_back(f);
+    }
+
+    void solve()
+    {
+        fleets.push_back({});
+        front(0, 0).push_back(0);
+        for (std::size_t j = 0; j < options.size(); j++)
+        {
+            const auto& x = options[j];
+            for (int k = 0; k < limits.ships; k++)
+                for (int g = 0; g + x.guns <= max_guns; g++)
+                {
+                    const auto& v = front(k, g); // adding goes to k + 1
+                    auto& to = front(k + 1, g + x.guns);
+                    batch.clear();
+                    for (std::size_t n = 0; n < v.size(); n++)
+                    {
+                        const fleet f = fleets[(std::size_t)v[n]];
+                        if (x.cost > limits.cost - f.cost || f.mass + x.mass > limits.mass)
+                            continue;
+                        // too slow even if the rest were the fastest there are
+                        if (f.slack + x.slack + (limits.ships - k - 1) * std::max(0., slack[j]) < 0)
+                            continue;
+                        const fleet bigger{ f.cost + x.cost, f.mass + x.mass, f.thrust + x.thrust, f.slack + x.slack,
+                                            f.guns + x.guns, k + 1, v[n], (unsigned)j };
+                        if (by_mass)
+                            batch.push_back(bigger);
+                        else
+                            add_by_slack(to, bigger);
+                    }
+                    if (!batch.empty())
+                        merge(to);
+                }
+        }
+    }
+
+    // the best 'wanted' of the fleets fast enough
+    std::vector<int> best(std::size_t wanted) const
+    {
+        std::vector<int> ret;
+        for (std::size_t i = (std::size_t)max_guns + 1; i < fronts.size(); i++)
+            for (int x : fronts[i])
+                if (fleets[(std::size_t)x].slack >= 0)
+                    ret.push_back(x);
+        const auto cmp = [this](int a, int b) { return fleets[(std::size_t)a] < fleets[(std::size_t)b]; };
+        std::stable_sort(ret.begin(), ret.end(), cmp);
+        ret.resize(std::min(ret.size(), wanted));
+        return ret;
+    }
+};
+
+int count_guns(const ship& st)
+{
+    int n = 0;
+    for (const auto* p : part::all_parts())
+        if (p->ammo < 0)
+            n += st.count(*p);
+    return n;
+}
+
+} // namespace
+
+fleet_pool::fleet_pool(const cmdline& params) :
+    params{params}, record_size{design::record_size(part::all_parts().size())}
+{
+}
+
+void fleet_pool::begin_loadout(int loadout_, int guns_)
+{
+    loadout = loadout_;
+    guns = guns_;
+    first = options.size();
+    first_record = records.size();
+}
+
+void fleet_pool::push(const ship& st)
+{
+    const double twr_mass = params.fleet.twr * 9.81 / 1000;
+    options.push_back({ loadout, guns, st.cost, (double)st.mass, (double)st.thrust,
+                        (double)st.thrust - twr_mass * (double)st.mass, records.size() });
+    records.resize(records.size() + record_size);
+    pack_record(&records[options.back().record], st);
+    // keeps memory in check for loadouts with lots of designs
+    if (options.size() >= next_compact)
+        compact();
+}
+
+void fleet_pool::end_loadout()
+{
+    compact();
+}
+
+// prunes this loadout's options and packs the records of the rest
+void fleet_pool::compact()
+{
+    constexpr std::size_t every = 1 << 16;
+    prune(options, first);
+    std::vector<unsigned char> kept;
+    kept.reserve((options.size() - first) * record_size);
+    for (std::size_t i = first; i < options.size(); i++)
+    {
+        const auto at = records.begin() + (std::ptrdiff_t)options[i].record;
+        options[i].record = first_record + kept.size();
+        kept.insert(kept.end(), at, at + (std::ptrdiff_t)record_size);
+    }
+    records.resize(first_record);
+    records.insert(records.end(), kept.begin(), kept.end());
+    next_compact = options.size() + every;
+}
+
+int design_fleet(const std::vector<ship>& loadouts, const std::vector<std::string>& labels,
+                 const cmdline& params)
+{
+    cmdline search_params = params;
+    search_params.num_matches = INT_MAX;
+    fleet_pool pool{params};
+    search_control control;
+    control.fleet = &pool;
+
+    for (std::size_t i = 0; i < loadouts.size(); i++)
+    {
+        trace_span t{"loadout"};
+        const std::uint64_t total = search_space(params) * (unsigned)search_passes(params);
+        pool.begin_loadout((int)i, count_guns(loadouts[i]));
+        search_candidates(loadouts[i], search_params, 0, total, control);
+        pool.end_loadout();
+    }
+
+    // designs of different loadouts with as many guns are as good as each other
+    auto& options = pool.options;
+    std::stable_sort(options.begin(), options.end(), [](const option& a, const option& b) { return a.guns > b.guns; });
+    std::vector<option> kept;
+    for (std::size_t i = 0, j; i < options.size(); i = j)
+    {
+        for (j = i; j < options.size() && options[j].guns == options[i].guns; j++)
+            ;
+        const std::size_t at = kept.size();
+        kept.insert(kept.end(), options.begin() + (std::ptrdiff_t)i, options.begin() + (std::ptrdiff_t)j);
+        prune(kept, at);
+    }
+
+    fleet_solver solver{kept, params.fleet};
+    {
+        trace_span t{"solve"};
+        solver.solve();
+    }
+    const auto best = solver.best(params.num_matches == INT_MAX ? 1u : (std::size_t)params.num_matches);
+    if (best.empty())
+    {
+        WARN("no fleet could be put together within the limits.");
+        return 1;
+    }
+
+    std::size_t width = 0;
+    for (const auto& x : labels)
+        width = std::max(width, x.size());
+    const auto& parts = part::all_parts();
+    ship st{*params.catalog};
+    std::vector<unsigned> ships;
+    for (std::size_t k = 0; k < best.size(); k++)
+    {
+        const auto& f = solver.fleets[(std::size_t)best[k]];
+        printf("%sfleet %zu: %d ships, %d guns, cost %lld, mass %.0f, twr %.1f\n", k ? "\n" : "",
+               k + 1, f.ships, f.guns, (long long)f.cost, f.mass,
+               f.mass > 0 ? f.thrust * 1000 / (f.mass * 9.81) : 0.);
+        ships.clear();
+        for (const fleet* x = &f; x->smaller >= 0; x = &solver.fleets[(std::size_t)x->smaller])
+            ships.push_back(x->option);
+        for (auto it = ships.rbegin(); it != ships.rend(); it++)
+        {
+            unpack_record(&pool.records[kept[*it].record], st, parts);
+            printf("  %-*s  ", (int)width, labels[(std::size_t)kept[*it].loadout].c_str());
+            report_pretty(st, 0);
+        }
+    }
+    fflush(stdout);
+    return 0;
+}
+
+} // namespace hf::design
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace hf::design {
+
+struct ship;
+struct cmdline;
+
+// --fleet: up to 'ships' ships, each of one of the loadouts given on the
+// command line, under a total cost and mass, together at least 'twr'.
+// the best fleets have the most guns, then cost and weigh the least.
+struct fleet_limits final
+{
+    int ships = 0;
+    std::int64_t cost = std::numeric_limits<std::int64_t>::max();
+    double mass = std::numeric_limits<double>::max();
+    float twr = 0;
+
+    bool enabled() const { return ships > 0; }
+};
+
+// takes the designs of a --fleet search, one loadout after another. only
+// keeps those that no fleet would rather swap for a cheaper, lighter and
+// faster design with the same guns.
+struct fleet_pool final
+{
+    struct option final
+    {
+        int loadout, guns;
+        std::int64_t cost;
+        double mass, thrust, slack; // slack: thrust over what --fleet-twr asks of its mass
+        std::size_t record;         // offset into 'records'
+    };
+
+    explicit fleet_pool(const cmdline& params);
+
+    // the designs pushed until end_loadout() are for this loadout
+    void begin_loadout(int loadout, int guns);
+    void push(const ship& st);
+    void end_loadout();
+
+    std::vector<option> options;
+    std::vector<unsigned char> records;
+
+private:
+    void compact();
+
+    const cmdline& params;
+    const std::size_t record_size;
+    std::size_t first = 0, first_record = 0; // of this loadout
+    std::size_t next_compact = 1 << 16;
+    int loadout = 0, guns = 0;
+};
+
+// searches each loadout, then prints the best -n fleets (1 by default).
+// 'labels' name the loadouts for the output.
+int design_fleet(const std::vector<ship>& loadouts, const std::vector<std::string>& labels,
+                 const cmdline& params);
+
+} // namespace hf::design
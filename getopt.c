@@ -108,3 +108,81 @@ int musl_getopt(int argc, const char* const* argv, const char* optstring)
     }
     return c;
 }
+
+/* getopt_long() without argv permutation, the caller's argv is const */
+int musl_getopt_long(int argc, const char* const* argv, const char* optstring,
+                     const struct musl_option* longopts, int* idx)
+{
+    if (!optind || optreset) {
+        optreset = 0;
+        optpos = 0;
+        optind = 1;
+    }
+
+    if (optind >= argc || !argv[optind])
+        return -1;
+
+    optarg = 0;
+    if (longopts && argv[optind][0] == '-' && argv[optind][1] == '-' && argv[optind][2]) {
+        int colon = optstring[optstring[0] == '+' || optstring[0] == '-'] == ':';
+        int i, cnt, match = 0;
+        const char *arg = NULL, *opt, *start = argv[optind] + 2;
+        for (cnt = i = 0; longopts[i].name; i++) {
+            const char* name = longopts[i].name;
+            opt = start;
+            while (*opt && *opt != '=' && *opt == *name)
+                name++, opt++;
+            if (*opt && *opt != '=')
+                continue;
+            arg = opt;
+            match = i;
+            if (!*name) {
+                cnt = 1;
+                break;
+            }
+            cnt++;
+        }
+        if (cnt == 1) {
+            i = match;
+            opt = arg;
+            optind++;
+            if (*opt == '=') {
+                if (!longopts[i].has_arg) {
+                    optopt = longopts[i].val;
+                    if (colon || !opterr)
+                        return '?';
+                    musl_getopt_msg(argv[0], ": option does not take an argument: ",
+                                    longopts[i].name, strlen(longopts[i].name));
+                    return '?';
+                }
+                optarg = opt + 1;
+            } else if (longopts[i].has_arg == musl_required_argument) {
+                if (!(optarg = argv[optind])) {
+                    optopt = longopts[i].val;
+                    if (colon)
+                        return ':';
+                    if (!opterr)
+                        return '?';
+                    musl_getopt_msg(argv[0], ": option requires an argument: ",
+                                    longopts[i].name, strlen(longopts[i].name));
+                    return '?';
+                }
+                optind++;
+            }
+            if (idx)
+                *idx = i;
+            if (longopts[i].flag) {
+                *longopts[i].flag = longopts[i].val;
+                return 0;
+            }
+            return longopts[i].val;
+        }
+        optopt = 0;
+        if (!colon && opterr)
+            musl_getopt_msg(argv[0], cnt ? ": option is ambiguous: " : ": unrecognized option: ",
+                            argv[optind] + 2, strlen(argv[optind] + 2));
+        optind++;
+        return '?';
+    }
+    return musl_getopt(argc, argv, optstring);
+}
@@ -6,6 +6,16 @@ extern "C" {
 extern const char* musl_optarg;
 extern int musl_optind, musl_opterr, musl_optopt;
 int musl_getopt(int argc, const char* const* argv, const char* optstring);
+
+struct musl_option {
+    const char* name;
+    int has_arg;
+    int* flag;
+    int val;
+};
+enum { musl_no_argument, musl_required_argument, musl_optional_argument };
+int musl_getopt_long(int argc, const char* const* argv, const char* optstring,
+                     const struct musl_option* longopts, int* idx);
 #ifdef __cplusplus
 }
 #endif
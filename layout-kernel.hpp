@@ -0,0 +1,167 @@
+// no include guard -- part of the search kernel, included by
+// search-kernel.hpp once per instruction set.
+
+namespace hf::design::HF_DESIGN_ISA {
+
+enum class anchor : unsigned char { anywhere, bottom, edge };
+
+// bottom-left fill: the lowest row with room, then the leftmost column.
+// vertical thrusters must sit on the bottom row, corner pieces on the
+// outline of the grid.
+HF_DESIGN_TARGET static bool place(layout_grid& g, int w, int h, anchor where)
+{
+    const int W = g.width, H = g.height;
+    if (w > W || h > H)
+        return false;
+    const std::uint64_t starts = (std::uint64_t(1) << (W - w + 1)) - 1;
+    const std::uint64_t sides = 1 | std::uint64_t(1) << (W - w);
+    const std::uint64_t piece = (std::uint64_t(1) << w) - 1;
+    const int last = where == anchor::bottom ? 0 : H - h;
+
+    for (int y = 0; y <= last; y++)
+    {
+        std::uint64_t occ = 0;
+        for (int k = 0; k < h; k++)
+            occ |= g.rows[y + k];
+        std::uint64_t bad = occ;
+        for (int k = 1; k < w; k++)
+            bad |= occ >> k;
+        std::uint64_t free = ~bad & starts;
+        if (where == anchor::edge && y != 0 && y != H - h)
+            free &= sides;
+        if (free)
+        {
+            int x = bit_ctz(free);
+            for (int k = 0; k < h; k++)
+                g.rows[y + k] |= piece << x;
+            return true;
+        }
+    }
+    return false;
+}
+
+HF_DESIGN_TARGET static bool place_n(layout_grid& g, int n, int w, int h, anchor where)
+{
+    for (int i = 0; i < n; i++)
+        if (!place(g, w, h, where))
+            return false;
+    return true;
+}
+
+HF_DESIGN_TARGET static bool pack(layout_grid& g, const ship& st, int W, int H)
+{
+    const auto& fp = st.footprints;
+    const int rd51 = st.count(e_rd51), d30s = st.count(e_d30s);
+    ASSERT(fp[fp_4x4] >= rd51 && fp[fp_2x2] >= d30s);
+
+    g.width = W;
+    g.height = H;
+    for (int y = 0; y < H; y++)
+        g.rows[y] = 0;
+
+    if (!place_n(g, rd51, 4, 4, anchor::bottom) ||
+        !place_n(g, d30s, 2, 2, anchor::bottom) ||
+        !place_n(g, fp[fp_corner], 2, 2, anchor::edge) ||
+        !place_n(g, fp[fp_4x4] - rd51, 4, 4, anchor::anywhere) ||
+        !place_n(g, fp[fp_2x2] - d30s, 2, 2, anchor::anywhere))
+        return false;
+    for (int i = 0; i < fp[fp_1x2]; i++)
+        if (!place(g, 2, 1, anchor::anywhere) && !place(g, 1, 2, anchor::anywhere))
+            return false;
+    return place_n(g, fp[fp_1x1], 1, 1, anchor::anywhere);
+}
+
+// gaps enclosed by parts get filled with hull, so the outline is taken
+// around everything the outside can't reach.
+HF_DESIGN_TARGET static layout measure(const layout_grid& g)
+{
+    std::uint64_t cols = 0;
+    int h = 0;
+    for (int y = 0; y < g.height; y++)
+        if (g.rows[y])
+        {
+            cols |= g.rows[y];
+            h = y + 1;
+        }
+    const int w = bit_width(cols);
+    const std::uint64_t full = (std::uint64_t(1) << w) - 1;
+    const std::uint64_t sides = 1 | std::uint64_t(1) << (w - 1);
+
+    std::uint64_t outside[layout_limits::max_size];
+    for (int y = 0; y < h; y++)
+        outside[y] = ~g.rows[y] & (y == 0 || y == h - 1 ? full : sides);
+    for (bool changed = true; changed; )
+    {
+        changed = false;
+        for (int y = 0; y < h; y++)
+        {
+            std::uint64_t x = outside[y];
+            x |= x << 1 | x >> 1;
+            if (y > 0)
+                x |= outside[y - 1];
+            if (y + 1 < h)
+                x |= outside[y + 1];
+            x &= ~g.rows[y] & full;
+            changed |= x != outside[y];
+            outside[y] = x;
+        }
+    }
+
+    layout ret;
+    int cells = 0, solid_cells = 0, perimeter = 0;
+    std::uint64_t below = 0;
+    for (int y = 0; y < h; y++)
+    {
+        std::uint64_t solid = full & ~outside[y];
+        cells += bit_count(g.rows[y]);
+        solid_cells += bit_count(solid);
+        perimeter += bit_count(solid ^ solid << 1) + bit_count(solid ^ below);
+        below = solid;
+    }
+    perimeter += bit_count(below);
+
+    ret.width = (short)w;
+    ret.height = (short)h;
+    ret.perimeter = (short)perimeter;
+    ret.holes = (short)(solid_cells - cells);
+    ret.ok = true;
+    return ret;
+}
+
+HF_DESIGN_TARGET static layout pack_layout(const ship& st, const layout_limits& limits)
+{
+    using clock = std::chrono::steady_clock;
+    const auto deadline = clock::now() + std::chrono::microseconds(limits.budget_usecs);
+    const auto& fp = st.footprints;
+    const int area = fp[fp_1x1] + 2*fp[fp_1x2] + 4*(fp[fp_2x2] + fp[fp_corner]) + 16*fp[fp_4x4];
+    const int bottom = 4*st.count(e_rd51) + 2*st.count(e_d30s);
+    const int min_side = fp[fp_4x4] ? 4 : fp[fp_2x2] || fp[fp_corner] ? 2 : 1;
+
+    layout best;
+    layout_grid g;
+    if (area <= 0)
+        return best;
+
+    int w0 = std::max({ (int)std::ceil(std::sqrt((float)area)), bottom, min_side });
+    for (int W = w0; W <= limits.max_width; W++)
+    {
+        int h0 = std::max(min_side, (area + W - 1) / W);
+        // no W x H box beats what we have, and wider only gets worse
+        if (best.ok && 2*(W + h0) >= best.perimeter && W*W >= area)
+            break;
+        for (int H = h0; H <= std::min(limits.max_height, h0 + 3); H++)
+            if (pack(g, st, W, H))
+            {
+                layout x = measure(g);
+                if (!best.ok || x.perimeter < best.perimeter ||
+                    (x.perimeter == best.perimeter && x.width * x.height < best.width * best.height))
+                    best = x;
+                break;
+            }
+        if (clock::now() >= deadline)
+            break;
+    }
+    return best;
+}
+
+} // namespace hf::design::HF_DESIGN_ISA
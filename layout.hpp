@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+
+#ifdef _MSC_VER
+#   include <intrin.h>
+#endif
+
+namespace hf::design {
+
+struct layout_limits final
+{
+    static constexpr int max_size = 62; // a grid row is one 64-bit word
+
+    int max_width = max_size, max_height = max_size;
+    int budget_usecs = 500; // per design, the best packing so far is kept
+};
+
+struct layout final
+{
+    short width = 0, height = 0, perimeter = 0, holes = 0;
+    bool ok = false;
+};
+
+// one bit per cell, bit x of rows[y] is column x of row y. row 0 is the
+// bottom of the ship.
+struct layout_grid final
+{
+    std::uint64_t rows[layout_limits::max_size];
+    int width, height;
+};
+
+inline int bit_ctz(std::uint64_t x)
+{
+#ifdef _MSC_VER
+    unsigned long ret;
+    _BitScanForward64(&ret, x);
+    return (int)ret;
+#else
+    return __builtin_ctzll(x);
+#endif
+}
+
+inline int bit_width(std::uint64_t x)
+{
+#ifdef _MSC_VER
+    unsigned long ret;
+    return _BitScanReverse64(&ret, x) ? (int)ret + 1 : 0;
+#else
+    return x ? 64 - __builtin_clzll(x) : 0;
+#endif
+}
+
+inline int bit_count(std::uint64_t x)
+{
+#ifdef _MSC_VER
+    return (int)__popcnt64(x);
+#else
+    return __builtin_popcountll(x);
+#endif
+}
+
+} // namespace hf::design
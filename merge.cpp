@@ -0,0 +1,316 @@
+#include "part.hpp"
+#include "ship.hpp"
+#include "record.hpp"
+#include "report.hpp"
+#include "defs.hpp"
+#include "log.hpp"
+
+#include "getopt.h"
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#   include <io.h>
+#   include <fcntl.h>
+#endif
+
+// puts the output of 'hf-design --shard i/n' runs back together. shards
+// cover consecutive slices of the search order and tag each design with
+// its place in it, so merging by that number gives what a single run
+// prints, and stopping after -n designs gives what it prints with -n.
+
+namespace hf::design {
+
+namespace {
+
+enum class format : char { none, pretty, csv, bin };
+
+struct source final
+{
+    const char* name = nullptr;
+    FILE* stream = nullptr;
+    format kind = format::none; // none for an empty file
+    record_reader reader;
+    std::string header;         // csv column names, without Seq
+    ship st;                    // current design of a record file
+    std::string line;           // current csv row, without Seq
+    std::uint64_t seq = 0;
+    bool started = false;
+
+    void open(const char* filename);
+    bool next();
+
+    ~source() { if (stream) fclose(stream); }
+};
+
+void source::open(const char* filename)
+{
+    name = filename;
+    stream = fopen(name, "rb");
+    if (!stream)
+    {
+        ERR("%s: %s", name, strerror(errno));
+        terminate(EX_NOINPUT);
+    }
+
+    char magic[sizeof(record_header::magic)];
+    std::size_t n = fread(magic, 1, sizeof(magic), stream);
+    if (n == 0)
+        return;
+    if (n == sizeof(magic) && !memcmp(magic, record_header::magic, sizeof(magic)))
+    {
+        if (!reader.open(stream, name, true))
+            terminate(EX_DATAERR);
+        kind = format::bin;
+        return;
+    }
+
+    rewind(stream);
+    if (!read_line(stream, header) || strncmp(header.c_str(), "Seq,", 4))
+    {
+        ERR("%s: no Seq column, not the csv output of a shard", name);
+        terminate(EX_DATAERR);
+    }
+    header.erase(0, 4);
+    kind = format::csv;
+}
+
+bool source::next()
+{
+    std::uint64_t prev = seq;
+    switch (kind)
+    {
+    case format::bin:
+        if (!reader.read(st))
+            return false;
+        seq = st.seq;
+        break;
+    case format::csv: {
+        if (!read_line(stream, line))
+            return false;
+        char* end;
+        errno = 0;
+        seq = std::strtoull(line.c_str(), &end, 10);
+        if (end == line.c_str() || *end != ',' || errno)
+        {
+            ERR("%s: bad row -- '%s'", name, line.c_str());
+            terminate(EX_DATAERR);
+        }
+        line.erase(0, (std::size_t)(end - line.c_str()) + 1);
+        break;
+    }
+    default:
+        return false;
+    }
+    if (started && seq <= prev)
+    {
+        ERR("%s: designs out of order", name);
+        terminate(EX_DATAERR);
+    }
+    started = true;
+    return true;
+}
+
+// record files say which shard of which query they hold. all of them
+// have to be there, once.
+void check_shards(const std::vector<std::unique_ptr<source>>& sources)
+{
+    const source* first = nullptr;
+    std::vector<const char*> seen;
+    for (const auto& x : sources)
+    {
+        if (x->kind != format::bin)
+            continue;
+        const auto& h = x->reader.header;
+        if (!first)
+        {
+            first = x.get();
+            seen.assign((std::size_t)h.num_shards, nullptr);
+        }
+        if (h.num_shards != first->reader.header.num_shards || h.query != first->reader.header.query)
+        {
+            ERR("%s: shard of a different search than %s", x->name, first->name);
+            terminate(EX_DATAERR);
+        }
+        if (auto& other = seen[(std::size_t)h.shard])
+        {
+            ERR("%s: shard %d/%d already given by %s", x->name, h.shard, h.num_shards, other);
+            terminate(EX_DATAERR);
+        }
+        else
+            other = x->name;
+    }
+    for (std::size_t i = 0; i < seen.size(); i++)
+        if (!seen[i])
+        {
+            ERR("shard %zu/%zu is missing", i, seen.size());
+            terminate(EX_DATAERR);
+        }
+}
+
+[[noreturn]] void usage(const char* argv0)
+{
+    printf("usage: %s [-F <pretty|csv|bin>] [-n <int>] <file>...\n", argv0);
+    printf("this program merges the output of 'hf-design --shard' runs.\n\n");
+    printf("  %-29s %s\n", "-F <pretty|csv|bin>", "output format for bin shards");
+    printf("  %-29s %s\n", "-n <int>", "output limit");
+    printf("  %-29s %s\n", "-h", "this screen");
+    printf("\nshards given as csv are merged to csv.\n");
+    printf("\nexample: %s -n 100 shard-*.bin\n", argv0);
+    fflush(stdout);
+    terminate(stdout == stderr ? EX_USAGE : 0);
+}
+
+} // namespace
+
+extern "C" int main(int argc, char** argv)
+{
+#ifdef _WIN32
+    if (const char* c = strrchr(argv[0], '.'); c && *c)
+        argv[0][c - argv[0]] = '\0';
+    argv[0] = std::max(argv[0], strrchr(argv[0], '\\')+1);
+#endif
+    argv[0] = std::max(argv[0], strrchr(argv[0], '/')+1);
+
+    try {
+        format fmt = format::none;
+        int num_matches = INT_MAX;
+        for (int c; (c = musl_getopt(argc, argv, "F:n:h")) != -1; )
+            switch (c)
+            {
+            case 'F':
+                if (!strcmp(musl_optarg, "pretty"))
+                    fmt = format::pretty;
+                else if (!strcmp(musl_optarg, "csv"))
+                    fmt = format::csv;
+                else if (!strcmp(musl_optarg, "bin"))
+                    fmt = format::bin;
+                else
+                {
+                    ERR("invalid output format -- '%s'", musl_optarg);
+                    goto error;
+                }
+                break;
+            case 'n': {
+                char* end;
+                errno = 0;
+                long n = std::strtol(musl_optarg, &end, 10);
+                if (end == musl_optarg || *end || errno || n < 0 || n > INT_MAX)
+                {
+                    ERR("invalid output limit -- '%s'", musl_optarg);
+                    goto error;
+                }
+                num_matches = n ? (int)n : INT_MAX;
+                break;
+            }
+            case 'h':
+                usage(argv[0]);
+            default:
+                goto error;
+            }
+        if (musl_optind == argc)
+            usage(argv[0]);
+
+        {
+            std::vector<std::unique_ptr<source>> sources;
+            format kind = format::none;
+            std::uint64_t query = 0;
+            for (int i = musl_optind; i < argc; i++)
+            {
+                auto& x = *sources.emplace_back(std::make_unique<source>());
+                x.open(argv[i]);
+                if (x.kind != format::none && kind != format::none && x.kind != kind)
+                {
+                    ERR("%s: can't merge csv and bin shards", x.name);
+                    terminate(EX_USAGE);
+                }
+                if (x.kind != format::none)
+                    kind = x.kind;
+                if (x.kind == format::bin)
+                    query = x.reader.header.query;
+            }
+            check_shards(sources);
+
+            if (kind == format::csv && fmt != format::none && fmt != format::csv)
+            {
+                ERR("csv shards can only be merged to csv");
+                terminate(EX_USAGE);
+            }
+            if (fmt == format::none)
+                fmt = kind == format::csv ? format::csv : format::pretty;
+
+            if (kind == format::bin && fmt == format::bin)
+            {
+#ifdef _WIN32
+                _setmode(_fileno(stdout), _O_BINARY);
+#endif
+                record_header h;
+                h.query = query;
+                for (const auto* x : part::all_parts())
+                    h.part_names.emplace_back(x->name);
+                write_header(stdout, h);
+            }
+
+            using item = std::pair<std::uint64_t, std::size_t>;
+            std::priority_queue<item, std::vector<item>, std::greater<item>> queue;
+            for (std::size_t i = 0; i < sources.size(); i++)
+                if (sources[i]->next())
+                    queue.push({ sources[i]->seq, i });
+
+            int k = 0;
+            std::uint64_t last = 0;
+            while (!queue.empty() && k < num_matches)
+            {
+                const std::size_t i = queue.top().second;
+                auto& x = *sources[i];
+                queue.pop();
+                if (k > 0 && x.seq <= last)
+                {
+                    ERR("%s: overlaps another shard", x.name);
+                    terminate(EX_DATAERR);
+                }
+                last = x.seq;
+
+                if (kind == format::csv)
+                {
+                    if (k == 0)
+                        printf("%s\n", x.header.c_str());
+                    printf("%s\n", x.line.c_str());
+                }
+                else if (fmt == format::bin)
+                    write_record(stdout, x.st);
+                else if (fmt == format::csv)
+                    report_csv(x.st, k);
+                else
+                    report_pretty(x.st, k);
+                k++;
+
+                if (x.next())
+                    queue.push({ x.seq, i });
+            }
+            if (k == 0)
+            {
+                WARN("no designs could be generated within the constraints.");
+                return 1;
+            }
+        }
+        return 0;
+error:
+        fprintf(stderr, "Try '%s -h' for more information.\n", argv[0]);
+        return EX_USAGE;
+    } catch (const exit_status& x) {
+        return x.code;
+    }
+}
+
+} // namespace hf::design
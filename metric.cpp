@@ -0,0 +1,56 @@
+#include "metric.hpp"
+#include "log.hpp"
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+namespace hf::design {
+
+static constexpr metric_info metrics[] = {
+    { "cost",               metric::cost,               1 },
+    { "mass",               metric::mass,               1 },
+    { "power",              metric::power,              1 },
+    { "area",               metric::area,               1 },
+    { "fuel",               metric::fuel,               1 },
+    { "fuel_flow",          metric::fuel_flow,          1 },
+    { "thrust",             metric::thrust,             1 },
+    { "horizontal_thrust",  metric::horizontal_thrust,  1 },
+    { "twr",                metric::twr,                2 },
+    { "horizontal_twr",     metric::horizontal_twr,     2 },
+    { "combat_time",        metric::combat_time,        2 },
+    { "speed",              metric::speed,              3 },
+    { "fuel_usage",         metric::fuel_usage,         5 },
+    { "range",              metric::range,              5 },
+    { "width",              metric::width,              1 },
+    { "height",             metric::height,             1 },
+    { "perimeter",          metric::perimeter,          1 },
+    { "mission_fuel",       metric::mission_fuel,       1, metric_info::mission },
+    { "mission_time",       metric::mission_time,       1, metric_info::mission },
+    { "mission_range",      metric::mission_range,      1, metric_info::mission },
+    { "win_rate",           metric::win_rate,           1, metric_info::duel    },
+};
+
+static constexpr std::pair<const char*, metric> aliases[] = {
+    { "htwr",   metric::horizontal_twr  },
+    { "time",   metric::combat_time     },
+};
+
+const metric_info& metric_info_of(metric m)
+{
+    ASSERT((unsigned)m < std::size(metrics));
+    ASSERT(metrics[(unsigned)m].id == m);
+    return metrics[(unsigned)m];
+}
+
+const metric_info* find_metric(const char* name, std::size_t len)
+{
+    for (const auto& x : metrics)
+        if (strlen(x.name) == len && !strncmp(x.name, name, len))
+            return &x;
+    for (const auto& [alias, m] : aliases)
+        if (strlen(alias) == len && !strncmp(alias, name, len))
+            return &metric_info_of(m);
+    return nullptr;
+}
+
+} // namespace hf::design
@@ -0,0 +1,57 @@
+#pragma once
+#include "ship.hpp"
+#include <cstddef>
+
+namespace hf::design {
+
+enum class metric : unsigned char {
+    cost, mass, power, area, fuel, fuel_flow, thrust, horizontal_thrust,
+    twr, horizontal_twr, combat_time, speed, fuel_usage, range,
+    width, height, perimeter,
+    mission_fuel, mission_time, mission_range,
+    win_rate,
+};
+
+struct metric_info final
+{
+    enum stage_ : unsigned char { build, mission, duel };
+
+    const char* name;
+    metric id;
+    unsigned char cost; // rough relative price of computing it
+    stage_ stage = build;
+};
+
+const metric_info& metric_info_of(metric m);
+const metric_info* find_metric(const char* name, std::size_t len);
+
+constexpr double metric_value(const ship& st, metric m)
+{
+    switch (m)
+    {
+    case metric::cost:              return st.cost;
+    case metric::mass:              return (double)st.mass;
+    case metric::power:             return (double)st.power;
+    case metric::area:              return st.area;
+    case metric::fuel:              return (double)st.fuel;
+    case metric::fuel_flow:         return (double)st.fuel_flow;
+    case metric::thrust:            return (double)st.thrust;
+    case metric::horizontal_thrust: return (double)st.horizontal_thrust;
+    case metric::twr:               return (double)st.twr();
+    case metric::horizontal_twr:    return (double)st.horizontal_twr();
+    case metric::combat_time:       return (double)st.combat_time();
+    case metric::speed:             return (double)st.speed();
+    case metric::fuel_usage:        return (double)st.fuel_usage();
+    case metric::range:             return (double)st.range();
+    case metric::width:             return st.width;
+    case metric::height:            return st.height;
+    case metric::perimeter:         return st.perimeter;
+    case metric::mission_fuel:      return (double)st.mission.fuel;
+    case metric::mission_time:      return (double)st.mission.time;
+    case metric::mission_range:     return (double)st.mission.range;
+    case metric::win_rate:          return (double)st.duel.win_rate;
+    }
+    return 0;
+}
+
+} // namespace hf::design
@@ -0,0 +1,104 @@
+// no include guard -- part of the search kernel, included by
+// search-kernel.hpp once per instruction set.
+
+namespace hf::design::HF_DESIGN_ISA {
+
+// structure of arrays over a batch of designs, so that every step of the
+// integration is one straight loop across lanes.
+struct mission_batch final
+{
+    static constexpr int size = 64;
+
+    ship ships[size];
+    float mass0[size], fuel0[size], thrust[size], fuel_flow[size];
+    float mass[size], fuel[size], time[size], range[size];
+    int count = 0;
+};
+
+// speed is the game's twr * 90 km/h, with thrust scaled by throttle. on
+// the map fuel burns map_time_scale times slower than in combat.
+static constexpr float mission_speed_k = 1000 * 90 / 9.81f;
+
+HF_DESIGN_TARGET static void fly_cruise(mission_batch& b, float km, float throttle)
+{
+    const float dkm = km / mission_profile::steps;
+    const float rho = mission_profile::fuel_density;
+    for (int k = 0; k < mission_profile::steps; k++)
+        for (int i = 0; i < mission_batch::size; i++)
+        {
+            float v = throttle * b.thrust[i] * mission_speed_k / b.mass[i];
+            float dt = dkm / v;
+            float burn = throttle * b.fuel_flow[i] * dt * (3600 / mission_profile::map_time_scale);
+            b.fuel[i] -= burn;
+            b.mass[i] = std::max(b.mass[i] - burn * rho, b.mass0[i] - b.fuel0[i] * rho);
+            b.time[i] += dt;
+        }
+}
+
+HF_DESIGN_TARGET static void fly_combat(mission_batch& b, float secs, float throttle)
+{
+    const float dt = secs / mission_profile::steps;
+    const float rho = mission_profile::fuel_density;
+    for (int k = 0; k < mission_profile::steps; k++)
+        for (int i = 0; i < mission_batch::size; i++)
+        {
+            float burn = throttle * b.fuel_flow[i] * dt;
+            b.fuel[i] -= burn;
+            b.mass[i] = std::max(b.mass[i] - burn * rho, b.mass0[i] - b.fuel0[i] * rho);
+            b.time[i] += dt / 3600;
+        }
+}
+
+// full tanks at cruise throttle, burnt in equal slices. each slice flies
+// at the speed of the ship's mass halfway through it.
+HF_DESIGN_TARGET static void fly_range(mission_batch& b)
+{
+    const float rho = mission_profile::fuel_density, throttle = mission_profile::cruise_throttle;
+    for (int i = 0; i < mission_batch::size; i++)
+        b.range[i] = 0;
+    for (int k = 0; k < mission_profile::steps; k++)
+        for (int i = 0; i < mission_batch::size; i++)
+        {
+            float slice = b.fuel0[i] / mission_profile::steps;
+            float mass = b.mass0[i] - ((float)k + .5f) * slice * rho;
+            float v = throttle * b.thrust[i] * mission_speed_k / mass;
+            float dt = slice / (throttle * b.fuel_flow[i]);
+            b.range[i] += v * dt * (mission_profile::map_time_scale / 3600);
+        }
+}
+
+HF_DESIGN_TARGET static void fly_mission(mission_batch& b, const mission_profile& profile)
+{
+    // unused lanes repeat the first design so the loops never divide by 0
+    for (int i = 0; i < mission_batch::size; i++)
+    {
+        const auto& st = b.ships[i < b.count ? i : 0];
+        b.mass0[i] = b.mass[i] = st.mass;
+        b.fuel0[i] = b.fuel[i] = st.fuel;
+        b.thrust[i] = st.thrust;
+        b.fuel_flow[i] = st.fuel_flow;
+        b.time[i] = 0;
+    }
+
+    for (int j = 0; j < profile.num_phases; j++)
+    {
+        const auto& x = profile.phases[j];
+        switch (x.kind)
+        {
+        case mission_phase::cruise: fly_cruise(b, x.amount, x.throttle); break;
+        case mission_phase::combat: fly_combat(b, x.amount, x.throttle); break;
+        }
+    }
+    fly_range(b);
+
+    for (int i = 0; i < b.count; i++)
+    {
+        auto& m = b.ships[i].mission;
+        m.fuel = b.fuel[i];
+        m.time = b.time[i];
+        m.range = b.range[i];
+        m.done = true;
+    }
+}
+
+} // namespace hf::design::HF_DESIGN_ISA
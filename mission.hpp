@@ -0,0 +1,47 @@
+#pragma once
+
+namespace hf::design {
+
+struct mission_phase final
+{
+    enum kind_ : unsigned char { cruise, combat };
+
+    kind_ kind;
+    float amount;   // km for cruise, seconds for combat
+    float throttle;
+};
+
+// flight plan the simulator runs every surviving design through. fuel
+// burns at the engines' flow times throttle, the ship gets lighter as it
+// does, and speed follows the lighter ship's twr.
+struct mission_profile final
+{
+    static constexpr int max_phases = 8;
+    static constexpr int steps = 16;            // integration steps per phase
+    static constexpr float fuel_density = .8f;  // t per fuel unit, as ship::mass
+    static constexpr float cruise_throttle = .7f;
+    static constexpr float map_time_scale = 50; // as in ship::range()
+
+    mission_phase phases[max_phases] = {};
+    int num_phases = 0;
+    bool enabled = false;
+
+    void set_default(int combat_time)
+    {
+        phases[0] = { mission_phase::cruise, 500, cruise_throttle };
+        phases[1] = { mission_phase::combat, (float)combat_time, 1 };
+        phases[2] = { mission_phase::cruise, 500, cruise_throttle };
+        num_phases = 3;
+        enabled = true;
+    }
+};
+
+// per-design results. 'fuel' goes negative when the tanks run dry before
+// the mission ends, 'time' is in hours, 'range' is cruise on full tanks.
+struct mission_result final
+{
+    float fuel = 0, time = 0, range = 0;
+    bool done = false;
+};
+
+} // namespace hf::design
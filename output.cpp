@@ -0,0 +1,130 @@
+#include "output.hpp"
+#include "part.hpp"
+#include "ship.hpp"
+#include "cmdline.hpp"
+#include "record.hpp"
+#include "report.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace hf::design {
+
+namespace {
+
+std::size_t pow2_at_least(std::size_t x)
+{
+    std::size_t n = 1;
+    while (n < x)
+        n <<= 1;
+    return n;
+}
+
+} // namespace
+
+output_pipe::output_pipe(const cmdline& params, int k, std::size_t depth) :
+    params{params},
+    slot_size{record_size(part::all_parts().size())},
+    mask{pow2_at_least(std::max<std::size_t>(depth, 2)) - 1},
+    slots((mask + 1) * slot_size),
+    parts{part::all_parts()},
+    k{k},
+    thread{&output_pipe::run, this}
+{
+}
+
+output_pipe::~output_pipe()
+{
+    closed.store(true);
+    {
+        std::lock_guard<std::mutex> l{lock};
+        wakeup.notify_all();
+    }
+    thread.join();
+    fflush(stdout);
+}
+
+int output_pipe::default_depth()
+{
+    // with a single cpu the writer only takes turns with the search
+    return std::thread::hardware_concurrency() > 1 ? 4096 : 0;
+}
+
+// spins a little, then sleeps until woken. the timeout is only there in
+// case a wakeup comes between checking and sleeping.
+template<typename F> void output_pipe::wait(std::atomic<bool>& waiting, F ready)
+{
+    for (int i = 0; i < 64; i++)
+    {
+        if (ready())
+            return;
+        std::this_thread::yield();
+    }
+    std::unique_lock<std::mutex> l{lock};
+    for (;;)
+    {
+        waiting.store(true);
+        if (ready())
+            break;
+        wakeup.wait_for(l, std::chrono::milliseconds(1));
+    }
+    waiting.store(false);
+}
+
+void output_pipe::wake(std::atomic<bool>& waiting)
+{
+    if (!waiting.exchange(false))
+        return;
+    std::lock_guard<std::mutex> l{lock};
+    wakeup.notify_all();
+}
+
+void output_pipe::push(const ship& st)
+{
+    const std::uint64_t size = mask + 1, h = head.load(std::memory_order_relaxed);
+    wait(search_waiting, [&] { return h - tail.load() < size; });
+    pack_record(&slots[(h & mask) * slot_size], st);
+    head.store(h + 1);
+    // the writer gets woken for half a ring's worth at a time
+    if (writer_waiting.load() && h + 1 - tail.load() >= size / 2)
+        wake(writer_waiting);
+}
+
+void output_pipe::drain()
+{
+    trace_span t{"drain"};
+    const std::uint64_t h = head.load(std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> l{lock};
+        wakeup.notify_all();
+    }
+    wait(search_waiting, [&] { return tail.load() == h; });
+    fflush(stdout);
+}
+
+void output_pipe::run()
+{
+    const std::uint64_t size = mask + 1;
+    ship st{*params.catalog};
+    trace::name_thread("writer");
+    for (std::uint64_t t = tail.load(); ; )
+    {
+        wait(writer_waiting, [&] { return head.load() != t || closed.load(); });
+        const std::uint64_t h = head.load();
+        if (h == t)
+            break;
+        trace_span write{"write"};
+        for (; t != h; t++)
+        {
+            unpack_record(&slots[(t & mask) * slot_size], st, parts);
+            report(st, k++, params);
+            tail.store(t + 1);
+            if (search_waiting.load() && h - (t + 1) <= size / 2)
+                wake(search_waiting);
+        }
+    }
+}
+
+} // namespace hf::design
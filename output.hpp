@@ -0,0 +1,58 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hf::design {
+
+struct ship;
+struct part;
+struct cmdline;
+
+// reported designs go into a ring of packed records, a writer thread
+// takes them out, formats and prints them. the search only blocks when
+// the ring is full. one producer, one consumer: both ends move their own
+// counter and read the other's, no locks on the way. the mutex is only
+// for sleeping when there's nothing to do.
+struct output_pipe final
+{
+    // 'k' is the number of designs reported before, for the csv header
+    output_pipe(const cmdline& params, int k, std::size_t depth);
+    ~output_pipe();
+
+    output_pipe(const output_pipe&) = delete;
+    output_pipe& operator=(const output_pipe&) = delete;
+
+    void push(const ship& st);
+    // returns once everything pushed is written out and flushed
+    void drain();
+
+    // the default --output-buffer, 0 for printing from the search thread
+    static int default_depth();
+
+private:
+    using counter = std::atomic<std::uint64_t>;
+
+    void run();
+    template<typename F> void wait(std::atomic<bool>& waiting, F ready);
+    void wake(std::atomic<bool>& waiting);
+
+    const cmdline& params;
+    const std::size_t slot_size, mask;
+    std::vector<unsigned char> slots;
+    std::vector<const part*> parts;
+    int k;
+
+    alignas(64) counter head{0};    // slots filled, moved by the search
+    alignas(64) counter tail{0};    // slots written, moved by the writer
+    alignas(64) std::atomic<bool> closed{false};
+    std::atomic<bool> writer_waiting{false}, search_waiting{false};
+    std::mutex lock;
+    std::condition_variable wakeup;
+    std::thread thread;
+};
+
+} // namespace hf::design
@@ -13,6 +13,12 @@ static auto& static_parts()
     return ret;
 }
 
+static auto& static_parts_by_index()
+{
+    static std::vector<const part*> ret;
+    return ret;
+}
+
 static bool part_lessp(const part* a, const part* b) { return strcmp(a->name, b->name) < 0; }
 static bool part_name_lessp(const part* a, const char* b) { return strcmp(a->name, b) < 0; }
 
@@ -35,6 +41,7 @@ part::part(const char* name, double mass, double power, part_size size, int pric
         ABORT("duplicate part -- '%s' - %s", name, (**it).name);
     parts.insert(it, this);
     index = global_idx++;
+    static_parts_by_index().push_back(this);
 }
 
 part::~part()
@@ -51,6 +58,12 @@ const std::vector<const part*>& part::all_parts()
     return static_parts();
 }
 
+const part& part::at(unsigned index)
+{
+    ASSERT(index < static_parts_by_index().size());
+    return *static_parts_by_index()[index];
+}
+
 const part& part::find_part(const char* str)
 {
     const auto& parts = part::all_parts();
@@ -87,4 +100,9 @@ const part& part::find_hull(const part& x)
     }
 }
 
+bool part::is_hull() const
+{
+    return !strncmp(name, "h_", 2) || !strncmp(name, "rh_", 3);
+}
+
 } // namespace hf::design
@@ -5,9 +5,13 @@ namespace hf::design {
 
 enum part_size : int { sz_1x1 = 1, sz_2x2 = 4, sz_1x2 = 2, sz_4x4 = 16, sz_bigfuel = -16, sz_cor = -4, sz_nan = 0};
 
+// shape on the layout grid; corner pieces are 2x2 and sit on the outline
+enum footprint : unsigned char { fp_1x1, fp_1x2, fp_2x2, fp_4x4, fp_corner, fp_count, fp_none = fp_count };
+
 struct part final
 {
     static const std::vector<const part*>& all_parts();
+    static const part& at(unsigned index); // by part::index
     static unsigned global_idx;
 
     float mass, power;
@@ -31,8 +35,22 @@ struct part final
 
     static const part& find_part_or_die(const char* str);
     static const part& find_hull(const part& x);
+    bool is_hull() const; // h_* and rh_*
     static const part& find_part(const char* str);
     constexpr int area() const { return size_ < 0 ? -size_ : size_; }
+    constexpr footprint shape() const
+    {
+        switch (size_)
+        {
+        case sz_1x1:        return fp_1x1;
+        case sz_1x2:        return fp_1x2;
+        case sz_2x2:        return fp_2x2;
+        case sz_4x4:
+        case sz_bigfuel:    return fp_4x4;
+        case sz_cor:        return fp_corner;
+        default:            return fp_none;
+        }
+    }
 };
 
 constexpr inline bool operator==(const part& a, const part& b) { return &a == &b; }
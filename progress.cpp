@@ -0,0 +1,150 @@
+#include "progress.hpp"
+#include "search.hpp"
+#include "space.hpp"
+#include "cmdline.hpp"
+#include "ship.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <iterator>
+#include <cstdio>
+
+namespace hf::design {
+
+namespace {
+
+using seconds = std::chrono::duration<double>;
+
+// 1234567 -> "1.2M"
+const char* si(double x, char (&buf)[16])
+{
+    constexpr const char* units[] = { "", "k", "M", "G", "T" };
+    unsigned i = 0;
+    for (; x >= 1000 && i + 1 < std::size(units); i++)
+        x /= 1000;
+    snprintf(buf, sizeof(buf), i ? "%.1f%s" : "%.0f%s", x, units[i]);
+    return buf;
+}
+
+// three long longs of any size, two colons and the nul
+using hms_buf = char[3 * 21 + 3];
+
+const char* hms(double secs, hms_buf& buf)
+{
+    if (!(secs >= 0 && secs < 1e8))
+        return "--:--:--";
+    auto t = (long long)(secs + .5);
+    snprintf(buf, sizeof(buf), "%lld:%02lld:%02lld", t / 3600, t / 60 % 60, t % 60);
+    return buf;
+}
+
+} // namespace
+
+progress_meter::progress_meter(const search_control& control, std::uint64_t total, int secs) :
+    control{control}, total{total}, interval{secs},
+    thread{&progress_meter::run, this}
+{
+}
+
+progress_meter::~progress_meter()
+{
+    {
+        std::lock_guard<std::mutex> l{lock};
+        finished = true;
+    }
+    wakeup.notify_one();
+    thread.join();
+}
+
+void progress_meter::run()
+{
+    trace::name_thread("progress");
+    std::unique_lock<std::mutex> l{lock};
+    std::uint64_t last_searched = 0;
+    clock::time_point last_time = start;
+    while (!wakeup.wait_for(l, interval, [this] { return finished; }))
+        print(clock::now(), last_searched, last_time);
+}
+
+// throughput over the last interval, the eta from the average so far
+void progress_meter::print(clock::time_point now, std::uint64_t& last_searched, clock::time_point& last_time) const
+{
+    const std::uint64_t searched = std::min(control.searched.load(std::memory_order_relaxed), this->total);
+    const int designs = control.designs.load(std::memory_order_relaxed);
+    const double done = (double)searched, total = (double)this->total;
+    const double rate = (double)(searched - last_searched) / seconds(now - last_time).count();
+    const double avg = done / seconds(now - start).count();
+    char b1[16], b2[16];
+    hms_buf b3;
+
+    fprintf(stderr, "progress: %5.1f%% of %s candidates, %s/s, %d designs, eta %s\n",
+            total > 0 ? 100 * done / total : 100., si(total, b1), si(rate, b2), designs,
+            hms(avg > 0 ? (total - done) / avg : -1, b3));
+    fflush(stderr);
+    last_searched = searched;
+    last_time = now;
+}
+
+void dry_run(const ship& base, const cmdline& params)
+{
+    constexpr int slices = 16;       // spread over the space, cost varies across it
+    constexpr double budget = .25;   // seconds
+
+    const std::uint64_t space = search_space(params);
+    const int passes = search_passes(params);
+    const std::uint64_t total = space * (unsigned)passes;
+    const auto shard = shard_range(total, params.shard, params.num_shards);
+    const std::uint64_t n = shard.end - shard.begin;
+    char b1[16], b2[16];
+
+    printf("candidates: %llu", (unsigned long long)total);
+    if (passes > 1)
+        printf(" in %d passes of %llu", passes, (unsigned long long)space);
+    printf("\n");
+    if (params.use_shards)
+        printf("shard %d/%d: %llu, from %llu\n", params.shard, params.num_shards,
+               (unsigned long long)n, (unsigned long long)shard.begin);
+    fflush(stdout);
+
+    cmdline p = params;
+    p.num_matches = INT_MAX;
+    std::uint64_t size = 256, searched = 0;
+    int designs = 0;
+    double secs = 0;
+    for (;;)
+    {
+        search_control c;
+        c.quiet = true;
+        searched = 0;
+        const auto t0 = progress_meter::clock::now();
+        for (int i = 0; i < slices; i++)
+        {
+            std::uint64_t a = shard.begin + n * (unsigned)i / slices;
+            std::uint64_t b = std::min(a + size, shard.begin + n * (unsigned)(i + 1) / slices);
+            search_candidates(base, p, a, b, c);
+            searched += b - a;
+        }
+        secs = seconds(progress_meter::clock::now() - t0).count();
+        designs = c.num_designs;
+        if (secs >= budget || searched >= n)
+            break;
+        size *= 2;
+    }
+
+    const double rate = searched / std::max(secs, 1e-9);
+    double est_designs = searched ? (double)designs * (double)n / (double)searched : 0;
+    double est_secs = (double)n / rate;
+    // -n cuts the search short about where it has found enough
+    if (est_designs > params.num_matches)
+    {
+        est_secs *= params.num_matches / est_designs;
+        est_designs = params.num_matches;
+    }
+    printf("calibration: %llu candidates in %.2f s, %s/s on %s\n",
+           (unsigned long long)searched, secs, si(rate, b1), search_kernel::select().isa);
+    hms_buf b3;
+    printf("estimate: %s, %s designs, not counting output\n", hms(est_secs, b3), si(est_designs, b2));
+}
+
+} // namespace hf::design
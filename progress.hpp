@@ -0,0 +1,45 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace hf::design {
+
+struct ship;
+struct cmdline;
+struct search_control;
+
+// prints how far the search got to stderr every 'secs' seconds. runs on
+// a thread of its own and only reads what the search publishes, so the
+// search pays nothing for it.
+struct progress_meter final
+{
+    using clock = std::chrono::steady_clock;
+
+    progress_meter(const search_control& control, std::uint64_t total, int secs);
+    ~progress_meter();
+
+    progress_meter(const progress_meter&) = delete;
+    progress_meter& operator=(const progress_meter&) = delete;
+
+private:
+    void run();
+    void print(clock::time_point now, std::uint64_t& last_searched, clock::time_point& last_time) const;
+
+    const search_control& control;
+    const std::uint64_t total;
+    const std::chrono::seconds interval;
+    const clock::time_point start = clock::now();
+    std::mutex lock;
+    std::condition_variable wakeup;
+    bool finished = false;
+    std::thread thread;
+};
+
+// --dry-run: the size of the search and a guess how long it takes, from
+// searching a sample of it without printing anything.
+void dry_run(const ship& base, const cmdline& params);
+
+} // namespace hf::design
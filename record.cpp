@@ -0,0 +1,193 @@
+#include "record.hpp"
+#include "part.hpp"
+#include "part-list.hpp"
+#include "ship.hpp"
+#include "defs.hpp"
+#include "log.hpp"
+
+#include <cstring>
+
+namespace hf::design {
+
+namespace {
+
+// totals ahead of the part counts, see pack_record()
+constexpr std::size_t fixed_size = 8 + 6*4 + 2*4 + 3*2 + 2 + 3*4 + 4;
+
+// the flags byte
+constexpr std::uint8_t mission_done = 1, duel_done = 2;
+
+template<typename T> unsigned char* put(unsigned char* p, T x)
+{
+    memcpy(p, &x, sizeof(x));
+    return p + sizeof(x);
+}
+
+template<typename T> const unsigned char* get(const unsigned char* p, T& x)
+{
+    memcpy(&x, p, sizeof(x));
+    return p + sizeof(x);
+}
+
+} // namespace
+
+std::size_t record_size(std::size_t num_parts)
+{
+    return fixed_size + 2 * num_parts;
+}
+
+std::size_t record_header::record_size() const
+{
+    return design::record_size(part_names.size());
+}
+
+void write_header(FILE* stream, const record_header& h)
+{
+    unsigned char buf[8 + 4*4 + 8], *p = buf;
+    memcpy(p, record_header::magic, sizeof(record_header::magic));
+    p += sizeof(record_header::magic);
+    p = put(p, record_header::byte_order);
+    p = put(p, (std::uint32_t)h.shard);
+    p = put(p, (std::uint32_t)h.num_shards);
+    p = put(p, (std::uint32_t)h.part_names.size());
+    p = put(p, h.query);
+    fwrite(buf, 1, (std::size_t)(p - buf), stream);
+    for (const auto& name : h.part_names)
+        fwrite(name.c_str(), 1, name.size() + 1, stream);
+}
+
+void pack_record(unsigned char* buf, const ship& st)
+{
+    unsigned char* p = buf;
+    p = put(p, st.seq);
+    for (float x : { st.mass, st.power, st.fuel, st.fuel_flow, st.thrust, st.horizontal_thrust })
+        p = put(p, x);
+    p = put(p, (std::int32_t)st.area);
+    p = put(p, (std::int32_t)st.cost);
+    for (short x : { st.width, st.height, st.perimeter })
+        p = put(p, (std::int16_t)x);
+    p = put(p, (std::uint8_t)((st.mission.done ? mission_done : 0) | (st.duel.done ? duel_done : 0)));
+    p = put(p, (std::uint8_t)0);
+    for (float x : { st.mission.fuel, st.mission.time, st.mission.range, st.duel.win_rate })
+        p = put(p, x);
+    for (const auto* x : part::all_parts())
+        p = put(p, (std::uint16_t)st.count(*x));
+}
+
+void unpack_record(const unsigned char* buf, ship& st, const std::vector<const part*>& parts)
+{
+    const unsigned char* p = buf;
+    std::int32_t area, cost;
+    std::int16_t width, height, perimeter;
+    std::uint8_t flags, pad;
+
+    p = get(p, st.seq);
+    for (float* x : { &st.mass, &st.power, &st.fuel, &st.fuel_flow, &st.thrust, &st.horizontal_thrust })
+        p = get(p, *x);
+    p = get(p, area);
+    p = get(p, cost);
+    p = get(p, width);
+    p = get(p, height);
+    p = get(p, perimeter);
+    p = get(p, flags);
+    p = get(p, pad);
+    for (float* x : { &st.mission.fuel, &st.mission.time, &st.mission.range, &st.duel.win_rate })
+        p = get(p, *x);
+    st.area = area;
+    st.cost = cost;
+    st.width = width;
+    st.height = height;
+    st.perimeter = perimeter;
+    st.mission.done = (flags & mission_done) != 0;
+    st.duel.done = (flags & duel_done) != 0;
+
+    for (const auto* x : part::all_parts())
+        st.parts[x->index].second = 0;
+    for (const auto* x : parts)
+    {
+        std::uint16_t count;
+        p = get(p, count);
+        st.parts[x->index].second = count;
+    }
+}
+
+void write_record(FILE* stream, const ship& st)
+{
+    const std::size_t size = record_size(part::all_parts().size());
+    unsigned char buf[fixed_size + 2*256];
+    ASSERT(size <= sizeof(buf));
+    pack_record(buf, st);
+    fwrite(buf, 1, size, stream);
+}
+
+bool record_reader::open(FILE* stream_, const char* name_, bool after_magic)
+{
+    stream = stream_;
+    name = name_;
+
+    unsigned char head[8 + 4*4 + 8];
+    const unsigned char* p = head + sizeof(record_header::magic);
+    std::uint32_t order, shard, num_shards, num_parts;
+    const std::size_t skip = after_magic ? sizeof(record_header::magic) : 0;
+    if (fread(head + skip, 1, sizeof(head) - skip, stream) != sizeof(head) - skip ||
+        (!after_magic && memcmp(head, record_header::magic, sizeof(record_header::magic))))
+    {
+        ERR("%s: not a design record file", name);
+        return false;
+    }
+    p = get(p, order);
+    p = get(p, shard);
+    p = get(p, num_shards);
+    p = get(p, num_parts);
+    get(p, header.query);
+    if (order != record_header::byte_order)
+    {
+        ERR("%s: written on a machine of different byte order", name);
+        return false;
+    }
+    header.shard = (int)shard;
+    header.num_shards = (int)num_shards;
+
+    header.part_names.clear();
+    parts.clear();
+    for (std::uint32_t i = 0; i < num_parts; i++)
+    {
+        std::string s;
+        for (int c; (c = getc(stream)) != 0; )
+        {
+            if (c == EOF)
+            {
+                ERR("%s: truncated header", name);
+                return false;
+            }
+            s += (char)c;
+        }
+        const auto& x = part::find_part(s.c_str());
+        if (x == null_part && s != null_part.name)
+        {
+            ERR("%s: unknown part '%s'", name, s.c_str());
+            return false;
+        }
+        header.part_names.push_back(std::move(s));
+        parts.push_back(&x);
+    }
+    buf.resize(header.record_size());
+    return true;
+}
+
+bool record_reader::read(ship& st)
+{
+    std::size_t n = fread(buf.data(), 1, buf.size(), stream);
+    if (n == 0 && feof(stream))
+        return false;
+    if (n != buf.size())
+    {
+        ERR("%s: truncated record", name);
+        terminate(EX_DATAERR);
+    }
+
+    unpack_record(buf.data(), st, parts);
+    return true;
+}
+
+} // namespace hf::design
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace hf::design {
+
+struct ship;
+struct part;
+
+// binary design records, written by -F bin. a header naming the parts,
+// then one fixed-size record per design with its sequence number, the
+// ship's totals and a count for each part in header order. numbers are
+// in the writer's byte order; readers refuse files of the other one.
+struct record_header final
+{
+    static constexpr char magic[8] = { 'h', 'f', 'd', 'e', 's', '\0', '\0', '\2' };
+    static constexpr std::uint32_t byte_order = 0x01020304;
+
+    int shard = 0, num_shards = 1;
+    std::uint64_t query = 0;
+    std::vector<std::string> part_names; // all parts when writing
+
+    std::size_t record_size() const;
+};
+
+void write_header(FILE* stream, const record_header& h);
+void write_record(FILE* stream, const ship& st);
+
+// one record in memory, part counts in part::all_parts() order when
+// packing and in 'parts' order when unpacking
+std::size_t record_size(std::size_t num_parts);
+void pack_record(unsigned char* buf, const ship& st);
+void unpack_record(const unsigned char* buf, ship& st, const std::vector<const part*>& parts);
+
+struct record_reader final
+{
+    record_header header;
+
+    // false and an error message if the stream is not a record file. the
+    // magic has been read already when 'after_magic' is set.
+    bool open(FILE* stream, const char* name, bool after_magic = false);
+    // false at the end of the stream, exits on a truncated record
+    bool read(ship& st);
+
+private:
+    FILE* stream = nullptr;
+    const char* name = nullptr;
+    std::vector<const part*> parts;
+    std::vector<unsigned char> buf;
+};
+
+} // namespace hf::design
@@ -1,11 +1,20 @@
+#include "report.hpp"
 #include "part.hpp"
 #include "part-list.hpp"
 #include "ship.hpp"
+#include "cmdline.hpp"
+#include "record.hpp"
 #include "log.hpp"
 
 #include <cmath>
+#include <cstdio>
 #include <tuple>
 
+#ifdef _WIN32
+#   include <io.h>
+#   include <fcntl.h>
+#endif
+
 namespace hf::design {
 
 bool report_pretty(const ship& st, int)
@@ -27,10 +36,55 @@ bool report_pretty(const ship& st, int)
     printf(" pwr:%d,%d", st.count(pwr_1x2), st.count(pwr_2x2));
     printf(" tank:%2d,%d", st.count(tank_1x2), st.count(tank_4x4));
     printf(" legs:%d,%d", st.count(leg1), st.count(leg2));
-    printf(" armor:%4.0f", (double)std::round(st.count(arm_1x1) * arm_1x1.mass));
+    printf(" armor:%4.0f", (double)std::round(st.count(arm_1x1) * (*st.catalog)[arm_1x1].mass));
+    if (st.width > 0)
+        printf(" box:%dx%d", st.width, st.height);
+    if (st.mission.done)
+        printf(" mission:%s,%.0f range:%.0f", st.mission.fuel >= 0 ? "ok" : "dry",
+               (double)st.mission.fuel, (double)st.mission.range);
+    if (st.duel.done)
+        printf(" win:%.1f%%", 100 * (double)st.duel.win_rate);
     printf(".\n");
 
     return true;
 }
 
+bool report_bin(const ship& st, int)
+{
+    write_record(stdout, st);
+    return true;
+}
+
+void report_begin(const cmdline& params)
+{
+    if (params.format != cmdline::fmt_bin)
+        return;
+#ifdef _WIN32
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    record_header h;
+    h.shard = params.shard;
+    h.num_shards = params.num_shards;
+    h.query = params.query;
+    for (const auto* x : part::all_parts())
+        h.part_names.emplace_back(x->name);
+    write_header(stdout, h);
+}
+
+bool report(const ship& st, int k, const cmdline& params)
+{
+    switch (params.format)
+    {
+    case cmdline::fmt_csv:
+        return report_csv(st, k, params.use_shards, &params.columns);
+    case cmdline::fmt_bin:
+        return report_bin(st, k);
+    case cmdline::fmt_pretty:
+        if (params.columns.enabled())
+            return report_columns(st, params.columns);
+        return report_pretty(st, k);
+    }
+    return false;
+}
+
 } // namespace hf::design
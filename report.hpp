@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+namespace hf::design {
+
+struct part;
+struct ship;
+struct cmdline;
+
+// which designs a column is printed for unless --columns asks for it:
+// all, those of --layout, --mission or --duel, or none.
+enum class column_section : unsigned char { base, layout, mission, duel, extra };
+
+// --columns: what to print, in that order, and so all that gets worked
+// out for the report. ids are columns of report_csv(), or -1 - i for the
+// count of part::all_parts()[i].
+struct column_list final
+{
+    static constexpr int max_columns = 64;
+
+    short ids[max_columns] = {};
+    int count = 0;
+
+    bool enabled() const { return count > 0; }
+};
+
+// by its csv header, in any case and with _ for a space, by a metric or
+// by a part name. false if there's no such column.
+bool find_column(const char* name, std::size_t len, short& id);
+column_section column_section_of(short id);
+// the part a column counts, nullptr for the rest
+const part* column_part(short id);
+
+// a line of csv without its end, \r\n or \n. false at the end of the file.
+bool read_line(FILE* stream, std::string& s);
+
+// k counts the designs reported so far; the first one brings the header.
+bool report_pretty(const ship& st, int k);
+bool report_csv(const ship& st, int k, bool with_seq = false, const column_list* selected = nullptr);
+bool report_bin(const ship& st, int k);
+// the pretty format of --columns, name:value each
+bool report_columns(const ship& st, const column_list& selected);
+
+// in the format asked for on the command line. report_begin() comes
+// before the search, so that even an empty shard says which one it is.
+void report_begin(const cmdline& params);
+bool report(const ship& st, int k, const cmdline& params);
+
+} // namespace hf::design
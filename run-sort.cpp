@@ -0,0 +1,203 @@
+#include "run-sort.hpp"
+#include "trace.hpp"
+#include "defs.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace hf::design {
+
+namespace {
+
+[[noreturn]] void io_error()
+{
+    ERR("temporary file: %s", errno ? strerror(errno) : "truncated");
+    terminate(EX_IOERR);
+}
+
+FILE* new_run()
+{
+    FILE* f = tmpfile();
+    if (!f)
+    {
+        ERR("can't create a temporary file: %s", strerror(errno));
+        terminate(EX_CANTCREAT);
+    }
+    return f;
+}
+
+void put(FILE* f, const unsigned char* entry, std::size_t size)
+{
+    if (fwrite(entry, size, 1, f) != 1)
+        io_error();
+}
+
+std::uint64_t word(const unsigned char* p, std::size_t i)
+{
+    std::uint64_t x;
+    memcpy(&x, p + i * sizeof(x), sizeof(x));
+    return x;
+}
+
+} // namespace
+
+bool run_sorter::reader::next()
+{
+    errno = 0;
+    if (fread(entry.data(), entry.size(), 1, f) == 1)
+        return true;
+    if (ferror(f))
+        io_error();
+    return false;
+}
+
+bool run_sorter::later::operator()(std::size_t a, std::size_t b) const
+{
+    return sorter->less((*in)[b].entry.data(), (*in)[a].entry.data());
+}
+
+run_sorter::run_sorter(std::size_t entry_size, std::size_t key_words, std::size_t memory, std::uint64_t limit) :
+    entry_size{entry_size},
+    key_words{key_words},
+    capacity{std::max<std::size_t>(1, std::min<std::size_t>(memory / (entry_size + sizeof(slot)), UINT32_MAX))},
+    limit{limit}
+{
+    entries.reserve(capacity * entry_size); // pages only get used as entries come
+}
+
+run_sorter::~run_sorter()
+{
+    for (FILE* f : runs)
+        fclose(f);
+}
+
+unsigned char* run_sorter::push()
+{
+    if (entries.size() == capacity * entry_size)
+        spill();
+    const std::size_t at = entries.size();
+    entries.resize(at + entry_size);
+    return &entries[at];
+}
+
+bool run_sorter::less(const unsigned char* a, const unsigned char* b) const
+{
+    for (std::size_t i = 0; i < key_words; i++)
+        if (std::uint64_t x = word(a, i), y = word(b, i); x != y)
+            return x < y;
+    return false;
+}
+
+// sorts what's in memory, the first 'keep' of 'order' are wanted
+std::size_t run_sorter::sort_entries()
+{
+    trace_span t{"sort"};
+    const std::size_t n = entries.size() / entry_size;
+    order.resize(n);
+    for (std::size_t i = 0; i < n; i++)
+        order[i] = { word(&entries[i * entry_size], 0), (std::uint32_t)i };
+    const auto cmp = [this](const slot& a, const slot& b) {
+        if (a.key != b.key)
+            return a.key < b.key;
+        return less(&entries[(std::size_t)a.at * entry_size], &entries[(std::size_t)b.at * entry_size]);
+    };
+    const std::size_t keep = (std::size_t)std::min<std::uint64_t>(n, limit);
+    if (keep < n)
+        std::partial_sort(order.begin(), order.begin() + (std::ptrdiff_t)keep, order.end(), cmp);
+    else
+        std::sort(order.begin(), order.end(), cmp);
+    return keep;
+}
+
+// makes a run of what's in memory
+void run_sorter::spill()
+{
+    const std::size_t keep = sort_entries();
+    FILE* f = runs.emplace_back(new_run());
+    for (std::size_t i = 0; i < keep; i++)
+        put(f, &entries[(std::size_t)order[i].at * entry_size], entry_size);
+    entries.clear();
+}
+
+// runs [first, first + count) into a new one
+FILE* run_sorter::merge(std::size_t first, std::size_t count)
+{
+    trace_span t{"merge"};
+    std::vector<reader> from(count);
+    std::priority_queue<std::size_t, std::vector<std::size_t>, later> q{later{this, &from}};
+    for (std::size_t i = 0; i < count; i++)
+    {
+        from[i] = { runs[first + i], std::vector<unsigned char>(entry_size) };
+        rewind(from[i].f);
+        if (from[i].next())
+            q.push(i);
+    }
+    FILE* ret = new_run();
+    for (std::uint64_t n = 0; !q.empty() && n < limit; n++)
+    {
+        const std::size_t i = q.top();
+        q.pop();
+        put(ret, from[i].entry.data(), entry_size);
+        if (from[i].next())
+            q.push(i);
+    }
+    return ret;
+}
+
+void run_sorter::finish()
+{
+    // all of it fit, no need for files
+    if (runs.empty())
+    {
+        kept = sort_entries();
+        return;
+    }
+    if (!entries.empty())
+        spill();
+    entries = {};
+    order = {};
+
+    // more runs than can be open at once get merged in rounds
+    while (runs.size() > max_fanin)
+    {
+        std::vector<FILE*> merged;
+        for (std::size_t i = 0; i < runs.size(); i += max_fanin)
+        {
+            const std::size_t n = std::min(max_fanin, runs.size() - i);
+            merged.push_back(n > 1 ? merge(i, n) : runs[i]);
+            if (n > 1)
+                for (std::size_t j = i; j < i + n; j++)
+                    fclose(runs[j]);
+        }
+        runs = std::move(merged);
+    }
+    in.resize(runs.size());
+    for (std::size_t i = 0; i < runs.size(); i++)
+    {
+        in[i] = { runs[i], std::vector<unsigned char>(entry_size) };
+        rewind(in[i].f);
+        if (in[i].next())
+            queue.push(i);
+    }
+}
+
+const unsigned char* run_sorter::next()
+{
+    if (out == limit)
+        return nullptr;
+    if (runs.empty())
+        return out < kept ? &entries[(std::size_t)order[out++].at * entry_size] : nullptr;
+    if (last != SIZE_MAX && in[last].next())
+        queue.push(last);
+    last = SIZE_MAX;
+    if (queue.empty())
+        return nullptr;
+    last = queue.top();
+    queue.pop();
+    out++;
+    return in[last].entry.data();
+}
+
+} // namespace hf::design
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <queue>
+#include <vector>
+
+namespace hf::design {
+
+// fixed size entries in the order of their first 'key_words' 64-bit
+// words, as unsigned numbers. they're kept in memory until 'memory' is
+// full, then the lot gets sorted and spilled to a temporary file as a
+// run. finish() merges the runs down to what can be open at once and
+// next() hands the entries out, up to 'limit' of them, which is also all
+// a run needs to keep. used by --sort and hf-design-diff.
+struct run_sorter final
+{
+    run_sorter(std::size_t entry_size, std::size_t key_words, std::size_t memory, std::uint64_t limit = UINT64_MAX);
+    ~run_sorter();
+
+    run_sorter(const run_sorter&) = delete;
+    run_sorter& operator=(const run_sorter&) = delete;
+
+    // room for the next entry, for the caller to write
+    unsigned char* push();
+    void finish();
+    // the next entry in order, good until the next call, null at the end
+    const unsigned char* next();
+
+private:
+    static constexpr std::size_t max_fanin = 64; // runs merged at once
+
+    // the next entry of a run, read through a buffer of its own
+    struct reader final
+    {
+        FILE* f;
+        std::vector<unsigned char> entry;
+
+        bool next();
+    };
+    struct later final
+    {
+        const run_sorter* sorter;
+        const std::vector<reader>* in;
+
+        bool operator()(std::size_t a, std::size_t b) const;
+    };
+    // the first word by itself sorts without dragging the entries through the cache
+    struct slot final
+    {
+        std::uint64_t key;
+        std::uint32_t at;
+    };
+
+    bool less(const unsigned char* a, const unsigned char* b) const;
+    std::size_t sort_entries();
+    void spill();
+    FILE* merge(std::size_t first, std::size_t count);
+
+    const std::size_t entry_size, key_words, capacity;
+    const std::uint64_t limit;
+    std::vector<unsigned char> entries;
+    std::vector<slot> order;
+    std::size_t kept = 0;  // of 'order', once finished in memory
+    std::uint64_t out = 0; // entries handed out
+    std::vector<FILE*> runs;
+    std::vector<reader> in;
+    std::priority_queue<std::size_t, std::vector<std::size_t>, later> queue{later{this, &in}};
+    std::size_t last = SIZE_MAX; // reader of the entry handed out last
+};
+
+} // namespace hf::design
@@ -0,0 +1,705 @@
+// no include guard -- this file is included once per instruction set by
+// search.cpp, with HF_DESIGN_ISA naming the namespace and HF_DESIGN_TARGET
+// holding the function attribute for that variant.
+
+#include "layout-kernel.hpp"
+#include "mission-kernel.hpp"
+#include "duel-kernel.hpp"
+
+namespace hf::design::HF_DESIGN_ISA {
+
+// what a query asks of the kernel, fixed for the whole search. the walk
+// is compiled once for each combination, so stages a query doesn't use
+// aren't there and the ones it does aren't behind a test.
+enum : unsigned {
+    mode_armor = 1,     // -a
+    mode_layout = 2,    // --layout
+    mode_missions = 4,  // --mission or --duel, or a metric of theirs asked for
+    mode_big_tanks = 8, // -b, for the first tank variant of a candidate
+    mode_explain = 16,  // --explain
+    num_modes = 32,
+};
+
+HF_DESIGN_TARGET static unsigned kernel_mode(const cmdline& params, const near_misses* explain)
+{
+    return (params.armor_layers >= 1e-6f ? mode_armor : 0) | (params.use_layout ? mode_layout : 0) |
+           (params.mission.enabled || params.duel.enabled ? mode_missions : 0) | (params.use_big_tanks ? mode_big_tanks : 0) |
+           (explain ? mode_explain : 0);
+}
+
+HF_DESIGN_TARGET static void add_legs(ship& st, const cmdline& params, const candidate& c)
+{
+    if (params.chassis.enabled())
+    {
+        const part* parts[] = { &leg1, &leg2, &leg3, &leg4 };
+        st.add_part_(h_cor, params.chassis.nlegs ? params.chassis.nlegs : 2, ship::area_disabled);
+        for (unsigned i = 0; i < std::size(parts); i++)
+            st.add_part_(*parts[i], c.legs[i], ship::area_disabled);
+    }
+    else if (!single_leg_mount(st.count(e_d30s), st.count(e_rd51)))
+    {
+        st.add_part(leg2, 2);
+        st.add_part_(leg1, 2, ship::area_disabled);
+    }
+    else
+    {
+        st.add_part(leg2, 1); // gear connected to corner piece
+        st.add_part_(leg2, 6, ship::area_disabled); // connected to other gear
+        st.add_part_(leg1, 2, ship::area_disabled); // small legs for landing stability
+    }
+}
+
+template<bool big_tanks>
+HF_DESIGN_TARGET static bool add_fuel(ship& st, const cmdline& params, int num_extinguishers)
+{
+    ASSERT(st.fuel_flow > 1e-6f);
+    const float tank_fuel = (*st.catalog)[tank_1x2].fuel;
+    int num_tanks = (int)std::ceil(st.fuel_flow * params.combat_time / tank_fuel);
+    if constexpr (big_tanks)
+    {
+        float ratio = (*st.catalog)[tank_4x4].fuel / tank_fuel;
+        int num = (int)((std::max(0, num_tanks - st.sneaky_corners_left)) / ratio); // num_tanks / 11.25
+        if (!num)
+            return false;
+        num_tanks -= (int)(num * ratio);
+        ASSERT(num_tanks >= 0);
+        st.add_part_(tank_4x4, num);
+    }
+    const int sneaky = sneaky_tanks(st.sneaky_corners_left, num_tanks); // use the cornerless 2x2 pieces to stick in extra tanks
+    num_tanks -= sneaky;
+    st.sneaky_corners_left -= sneaky*2;
+    ASSERT(sneaky >= 0); ASSERT(num_tanks >= 0); ASSERT(st.sneaky_corners_left >= 0);
+    st.add_part(tank_1x2, num_tanks);
+    st.add_part_(tank_1x2, sneaky, ship::area_disabled);
+    st.add_part_(h_05, sneaky*2, ship::area_disabled);
+    st.add_part(fire, num_extinguishers);
+
+    ASSERT(st.fuel > 0);
+
+    return true;
+}
+
+struct generators final
+{
+    int small_gens = 0, big_gens = 0;
+    bool again = false; // an earlier power step takes as many
+};
+
+// for 'fraction' of what the ship draws. the fuel, extinguishers and armor
+// draw nothing, so that's known as soon as the legs are on.
+HF_DESIGN_TARGET static generators generators_for(const ship& st, float fraction)
+{
+    generators g;
+    float power = -st.power * fraction;
+    ASSERT(power > 1e-6f);
+    const float small = (*st.catalog)[pwr_1x2].power, big = (*st.catalog)[pwr_2x2].power;
+    float x = std::fmod(power, big);
+    if (x <= 2*small) // they weigh less than the full generator
+    {
+        g.small_gens = x > small ? 2 : 1;
+        power = std::max(0.f, power - small*g.small_gens);
+    }
+    g.big_gens = (int)std::ceil((power + 1e-6f) / big);
+    return g;
+}
+
+// for each power step. a remainder takes a big generator however small it
+// is, so less power can take as many generators as more did.
+HF_DESIGN_TARGET static void plan_power(const ship& frame, const cmdline& params, generators* g)
+{
+    const int steps = power_steps(params);
+    for (int k = 0; k < steps; k++)
+    {
+        g[k] = generators_for(frame, power_at(params, k));
+        for (int j = 0; j < k && !g[k].again; j++)
+            g[k].again = !g[j].again && g[j].small_gens == g[k].small_gens && g[j].big_gens == g[k].big_gens;
+    }
+}
+
+HF_DESIGN_TARGET static void add_power(ship& st, const generators& g)
+{
+    if (g.small_gens)
+        st.add_part(pwr_1x2, g.small_gens);
+    st.add_part(pwr_2x2, g.big_gens);
+}
+
+HF_DESIGN_TARGET static void add_armor(ship& st, const cmdline& params)
+{
+    float circumference = std::sqrt((float)st.area) * 4;
+    const part* static_engines[] = { &e_d30s };
+    for (const auto* part : static_engines)
+    {
+        int sz = std::abs(part->area());
+        ASSERT(sz >= 1);
+        circumference -= std::sqrt((float)sz) / 2;
+    }
+    ASSERT(circumference > 0);
+    int num_armor = (int)std::ceil(circumference*params.armor_layers);
+    st.add_part(arm_1x1, num_armor);
+}
+
+// no outline of this area is shorter than a square's. used to weed out
+// designs before packing them; mass only grows from here, so designs
+// failing minimum twr or maximum cost with this armor fail with any.
+HF_DESIGN_TARGET static void add_armor_bound(ship& st, const cmdline& params)
+{
+    float exposed = std::sqrt((float)st.area) * 4 - (float)(2*st.count(e_d30s) + 4*st.count(e_rd51));
+    if (exposed > 0)
+        st.add_part(arm_1x1, (int)std::ceil(exposed*params.armor_layers));
+}
+
+// same as add_armor() but around the packed outline. the bottoms of
+// vertical thrusters stay bare.
+template<bool armored>
+HF_DESIGN_TARGET static bool add_layout(ship& st, const cmdline& params)
+{
+    layout x = pack_layout(st, params.layout);
+    if (!x.ok)
+        return false;
+    st.width = x.width;
+    st.height = x.height;
+    st.perimeter = x.perimeter;
+    st.add_part_(h_1x1, x.holes, ship::area_disabled);
+
+    if constexpr (!armored)
+        return true;
+    int exposed = x.perimeter - 2*st.count(e_d30s) - 4*st.count(e_rd51);
+    ASSERT(exposed > 0);
+    int num_armor = (int)std::ceil((float)exposed*params.armor_layers);
+    st.add_part(arm_1x1, num_armor);
+    return true;
+}
+
+// what every variant of a candidate shares
+HF_DESIGN_TARGET static void build_engines(const ship& st_, ship& st, const cmdline& params,
+                                           const candidate& c, bool traced)
+{
+    trace_span t{"engines", traced};
+    st = st_;
+    st.mass += params.extra_mass;
+    st.power -= params.extra_power;
+    st.add_part(e_d30s, c.d30s);
+    st.add_part(e_rd51, c.rd51);
+    st.add_part(e_d30, c.d30);
+    st.add_part(e_nk25, c.nk25);
+    st.add_part(e_rd59, c.rd59);
+}
+
+// engines and legs, what the tank variants, extinguishers and power steps
+// of a chassis mix share
+HF_DESIGN_TARGET static void build_frame(const ship& st_, ship& st, const cmdline& params,
+                                         const candidate& c, bool traced)
+{
+    build_engines(st_, st, params, c, traced);
+    trace_span t{"legs", traced};
+    add_legs(st, params, c);
+}
+
+// a -C range can take in a chassis mix with no legs at all
+HF_DESIGN_TARGET static bool has_legs(const cmdline& params, const candidate& c)
+{
+    return !params.chassis.enabled() || c.legs[0] + c.legs[1] + c.legs[2] + c.legs[3] > 0;
+}
+
+// legs are the last of what every variant has, the rest only adds mass
+// and cost. so a frame short of -T or -H, or over -c, makes no design.
+HF_DESIGN_TARGET static bool frame_ok(const ship& frame, const cmdline& params)
+{
+    return frame.twr() >= params.twr.min && frame.horizontal_twr() >= params.horizontal_twr.min &&
+           frame.cost <= params.cost.max;
+}
+
+template<bool big_tanks>
+HF_DESIGN_TARGET static bool build_ship(const ship& frame, ship& st, const cmdline& params, const candidate& c,
+                                        const generators& g, bool traced = false)
+{
+    st = frame;
+    {
+        trace_span t{"fuel", traced};
+        if (!add_fuel<big_tanks>(st, params, c.fire))
+            return false;
+    }
+    trace_span t{"power", traced};
+    add_power(st, g);
+    return true;
+}
+
+// where designs of a candidate go: reported, or with -b the small-tank
+// ones spilled to a temporary file until the big-tank ones are all out.
+enum sink : unsigned char { to_report, to_spill, num_sinks };
+
+HF_DESIGN_TARGET static bool has_small(const search_range& r) { return r.small_begin < r.small_end; }
+
+// the walk covers both ranges of the pass
+HF_DESIGN_TARGET static std::uint64_t walk_begin(const search_range& r)
+{
+    if (!has_small(r))
+        return r.begin;
+    return r.begin < r.end ? std::min(r.begin, r.small_begin) : r.small_begin;
+}
+
+HF_DESIGN_TARGET static std::uint64_t walk_end(const search_range& r)
+{
+    if (!has_small(r))
+        return r.end;
+    return r.begin < r.end ? std::max(r.end, r.small_end) : r.small_end;
+}
+
+struct search_state final
+{
+    const ship& base;
+    ship& st;
+    const cmdline& params;
+    const search_range& range;
+    search_control& control;
+    int& num_designs = control.num_designs;
+    std::uint64_t idx = 0; // next candidate of the pass
+    unsigned ticks = 0;
+    const std::uint64_t first = walk_begin(range), last = walk_end(range);
+    const std::uint64_t searched = control.searched.load(std::memory_order_relaxed);
+    filter filter_ship = filter::compile(params);
+    filter filter_mission = filter::compile(params, metric_info::mission);
+    filter filter_duel = filter::compile(params, metric_info::duel);
+    const fighter enemy = params.duel.enemy(*params.catalog);
+    std::unique_ptr<mission_batch> missions[num_sinks]; // of --duel too
+    std::unique_ptr<design_summary> summary; // merged into the query's at the end
+    ship engines, frame;
+    std::vector<generators> power = std::vector<generators>((std::size_t)power_steps(params)); // of the frame
+    FILE* spill = nullptr;
+    int num_spilled = 0;
+    std::vector<unsigned char> buf;
+};
+
+// small-tank designs come after all big-tank ones, so once there are
+// enough of them for -n the rest can't make it.
+HF_DESIGN_TARGET static bool small_full(const search_state& s)
+{
+    return (std::int64_t)s.num_designs + s.num_spilled >= s.params.num_matches;
+}
+
+HF_DESIGN_TARGET static void spill(search_state& s, const ship& st)
+{
+    if (!s.spill)
+    {
+        if (!(s.spill = tmpfile()))
+        {
+            ERR("can't create a temporary file: %s", strerror(errno));
+            terminate(EX_CANTCREAT);
+        }
+        s.buf.resize(record_size(part::all_parts().size()));
+    }
+    pack_record(s.buf.data(), st);
+    if (fwrite(s.buf.data(), s.buf.size(), 1, s.spill) != 1)
+    {
+        ERR("temporary file: %s", strerror(errno));
+        terminate(EX_IOERR);
+    }
+    s.num_spilled++;
+}
+
+HF_DESIGN_TARGET static void deliver(search_state& s, const ship& st, sink to)
+{
+    if (to == to_report)
+        report_design(s.control, st, s.params, s.summary.get());
+    else if (s.control.quiet)
+        s.num_spilled++;
+    else
+        spill(s, st);
+}
+
+HF_DESIGN_TARGET static void flush_missions(search_state& s, sink to)
+{
+    auto& b = *s.missions[to];
+    if (!b.count)
+        return;
+    trace_span t{"missions"};
+    if (s.params.mission.enabled)
+        fly_mission(b, s.params.mission);
+    // the duels are dear, only those the mission leaves get to fight
+    int kept[mission_batch::size], num_kept = 0;
+    for (int i = 0; i < b.count; i++)
+        if (s.filter_mission(b.ships[i]))
+            kept[num_kept++] = i;
+    if (s.params.duel.enabled)
+        fight_duels(b.ships, kept, num_kept, s.enemy, s.params, s.control.duels);
+    for (int k = 0; k < num_kept && (to == to_report ? s.num_designs < s.params.num_matches : !small_full(s)); k++)
+        if (s.filter_duel(b.ships[kept[k]]))
+            deliver(s, b.ships[kept[k]], to);
+    b.count = 0;
+}
+
+HF_DESIGN_TARGET static void flush_missions(search_state& s)
+{
+    if (s.missions[to_report])
+        for (unsigned to = 0; to < num_sinks; to++)
+            flush_missions(s, (sink)to);
+}
+
+// the small-tank designs, in the order they were found
+HF_DESIGN_TARGET static void replay_spill(search_state& s)
+{
+    if (s.control.quiet)
+        s.num_designs += std::min(s.num_spilled, std::max(0, s.params.num_matches - s.num_designs));
+    if (!s.spill)
+        return;
+    trace_span t{"replay"};
+    const auto& parts = part::all_parts();
+    rewind(s.spill);
+    for (int i = 0; i < s.num_spilled && s.num_designs < s.params.num_matches; i++)
+    {
+        if (fread(s.buf.data(), s.buf.size(), 1, s.spill) != 1)
+        {
+            ERR("temporary file: %s", ferror(s.spill) ? strerror(errno) : "truncated");
+            terminate(EX_IOERR);
+        }
+        unpack_record(s.buf.data(), s.st, parts);
+        report_design(s.control, s.st, s.params, s.summary.get());
+    }
+    fclose(s.spill);
+    s.spill = nullptr;
+}
+
+// one tank variant of a frame, armored and filtered but not flown yet.
+// false if there's no such design.
+template<unsigned mode, bool big_tanks>
+HF_DESIGN_TARGET static bool build_design(const ship& frame, ship& st, const cmdline& params, const candidate& c,
+                                          const generators& g, filter& filter_ship, near_misses* explain,
+                                          std::uint64_t seq, bool traced)
+{
+    if (!build_ship<big_tanks>(frame, st, params, c, g, traced))
+        return false;
+    if constexpr ((mode & mode_armor) != 0)
+    {
+        trace_span t{"armor", traced};
+        if constexpr (!(mode & mode_layout))
+            add_armor(st, params);
+        else
+            add_armor_bound(st, params);
+    }
+
+    st.seq = seq;
+    if constexpr ((mode & mode_explain) != 0)
+        explain->push(st);
+    {
+        // before packing, only what the layout's holes and armor can't undo
+        trace_span t{"filter", traced};
+        if (!((mode & mode_layout) ? filter_ship.bound(st) : filter_ship(st)))
+            return false;
+    }
+
+    if constexpr ((mode & mode_layout) != 0)
+    {
+        trace_span t{"layout", traced};
+        build_ship<big_tanks>(frame, st, params, c, g);
+        st.seq = seq;
+        if (!add_layout<(mode & mode_armor) != 0>(st, params) || !filter_ship(st))
+            return false;
+    }
+    return true;
+}
+
+// one tank variant of the candidate whose frame was just built
+template<unsigned mode, bool big_tanks>
+HF_DESIGN_TARGET static void do_search2(search_state& s, const candidate& c, const generators& g,
+                                        std::uint64_t seq, sink to, bool traced)
+{
+    auto& st = s.st;
+
+    if (!build_design<mode & ~mode_missions, big_tanks>(s.frame, st, s.params, c, g, s.filter_ship,
+                                                         s.control.explain, seq, traced))
+        return;
+
+    if constexpr ((mode & mode_missions) != 0)
+    {
+        auto& b = *s.missions[to];
+        b.ships[b.count++] = st;
+        if (b.count == mission_batch::size)
+            flush_missions(s, to);
+    }
+    else
+    {
+        trace_span t{"report", traced};
+        deliver(s, st, to);
+    }
+}
+
+// true if the next 'size' candidates all come before the range, which
+// then steps over them.
+HF_DESIGN_TARGET static bool skip(search_state& s, std::uint64_t size)
+{
+    if (s.idx + size > s.first)
+        return false;
+    s.idx += size;
+    return true;
+}
+
+HF_DESIGN_TARGET static bool done(search_state& s);
+
+// true if any of the next 'size' candidates is in either range
+HF_DESIGN_TARGET static bool wanted(const search_state& s, std::uint64_t size)
+{
+    const auto& r = s.range;
+    return (s.idx < r.end && s.idx + size > r.begin) ||
+           (s.idx < r.small_end && s.idx + size > r.small_begin && !small_full(s));
+}
+
+// the variants of a set of engines, as variant_index() numbers them. the
+// engines go on once, the legs and the generators of the power steps once
+// per chassis mix. false when the search is done.
+template<unsigned mode>
+HF_DESIGN_TARGET static bool do_search1(search_state& s, candidate& c)
+{
+    const auto& r = s.range;
+    const auto& params = s.params;
+    const std::uint64_t mixes = chassis_mixes(params);
+    const int steps = power_steps(params);
+    const std::uint64_t per_mix = (std::uint64_t)extinguisher_counts(params) * (unsigned)steps;
+    const bool traced = trace::enabled && !(s.ticks & trace::sample_mask);
+    bool has_engines = false;
+
+    for (std::uint64_t mix = 0; mix < mixes; mix++)
+    {
+        if (skip(s, per_mix))
+            continue;
+        chassis_mix(params, mix, c);
+        if (!wanted(s, per_mix) || !has_legs(params, c))
+        {
+            s.idx += per_mix;
+            if (done(s))
+                return false;
+            continue;
+        }
+        if (mixes == 1)
+            build_frame(s.base, s.frame, params, c, traced);
+        else
+        {
+            if (!has_engines)
+                build_engines(s.base, s.engines, params, c, traced);
+            has_engines = true;
+            s.frame = s.engines;
+            trace_span t{"legs", traced};
+            add_legs(s.frame, params, c);
+        }
+        // --explain wants to see them fail
+        if (!(mode & mode_explain) && !frame_ok(s.frame, params))
+        {
+            s.idx += per_mix;
+            if (done(s))
+                return false;
+            continue;
+        }
+        plan_power(s.frame, params, s.power.data());
+        for (c.fire = params.extinguishers.min; c.fire <= params.extinguishers.max; c.fire++)
+            for (c.power = 0; c.power < steps; c.power++, s.idx++)
+            {
+                if (done(s))
+                    return false;
+                // the same design as an earlier step
+                const generators& g = s.power[(std::size_t)c.power];
+                if (g.again)
+                    continue;
+                const bool big = s.idx >= r.begin && s.idx < r.end;
+                const bool small = s.idx >= r.small_begin && s.idx < r.small_end && !small_full(s);
+                if (big)
+                    do_search2<mode, (mode & mode_big_tanks) != 0>(s, c, g, r.seq + s.idx, to_report, traced);
+                if (small)
+                    do_search2<mode, false>(s, c, g, r.small_seq + s.idx, to_spill, traced);
+            }
+    }
+    return true;
+}
+
+// everything before the cursor has been reported when the checkpoint is
+// saved, missions in flight included. checkpointed searches don't spill.
+HF_DESIGN_TARGET static void save_checkpoint(search_state& s)
+{
+    auto& c = *s.control.ckpt;
+    trace_span t{"checkpoint"};
+    ASSERT(!has_small(s.range));
+    flush_missions(s);
+    if (s.control.output)
+        s.control.output->drain();
+    fflush(stdout);
+    c.cursor = s.range.seq + s.idx;
+    c.num_designs = s.num_designs;
+    c.save();
+    s.control.stopped = checkpoint::caught_signal() != 0;
+}
+
+HF_DESIGN_TARGET static std::uint64_t behind(std::uint64_t idx, std::uint64_t begin, std::uint64_t end)
+{
+    return begin < end ? std::clamp(idx, begin, end) - begin : 0;
+}
+
+// candidates of the pass behind the walk, of either range
+HF_DESIGN_TARGET static std::uint64_t searched(const search_state& s)
+{
+    const auto& r = s.range;
+    return s.searched + behind(s.idx, r.begin, r.end) + behind(s.idx, r.small_begin, r.small_end);
+}
+
+HF_DESIGN_TARGET static void tick(search_state& s)
+{
+    s.control.searched.store(searched(s), std::memory_order_relaxed);
+    s.control.designs.store(s.num_designs, std::memory_order_relaxed);
+    if (s.control.ckpt && s.control.ckpt->due())
+        save_checkpoint(s);
+}
+
+HF_DESIGN_TARGET static bool done(search_state& s)
+{
+    constexpr unsigned tick_mask = 4095;
+    if (!(++s.ticks & tick_mask))
+        tick(s);
+    return s.idx >= s.last || s.num_designs >= s.params.num_matches || s.control.stopped ||
+           (s.idx >= s.range.end && small_full(s));
+}
+
+template<unsigned mode>
+HF_DESIGN_TARGET static void search_engines(search_state& s)
+{
+    const auto& params = s.params;
+    const std::uint64_t variants = variant_space(params);
+    const std::uint64_t maneuvers = maneuver_space(params) * variants;
+
+    if (params.use_big_engines)
+        for (int F = params.fixed_engines.min; F <= params.engines.max; F++)
+        {
+            if (skip(s, fixed_mixes(params, F) * maneuvers))
+                continue;
+            trace_span chunk{"chunk"};
+            for (int num_d30s = 0; num_d30s <= F; num_d30s++)
+            {
+                if (skip(s, maneuvers))
+                    continue;
+                for (int N = params.engines.min; N <= params.engines.max; N++)
+                {
+                    if (skip(s, maneuver_mixes(params, N) * variants))
+                        continue;
+                    for (int num_d30 = 0; num_d30 <= N; num_d30++)
+                    {
+                        if (skip(s, ((std::uint64_t)(N - num_d30) + 1) * variants))
+                            continue;
+                        for (int num_nk25 = 0; num_nk25 <= N - num_d30; num_nk25++)
+                        {
+                            if (skip(s, variants))
+                                continue;
+                            int num_rd59 = N - num_d30 - num_nk25;
+                            int num_rd51 = F - num_d30s;
+                            candidate c{ num_d30s, num_rd51, num_d30, num_nk25, num_rd59 };
+                            if (!do_search1<mode>(s, c))
+                                return;
+                        }
+                    }
+                }
+            }
+        }
+    else
+        for (int num_d30s = params.fixed_engines.min; num_d30s <= params.fixed_engines.max; num_d30s++)
+        {
+            if (skip(s, maneuvers))
+                continue;
+            trace_span chunk{"chunk"};
+            for (int N = params.engines.min; N <= params.engines.max; N++)
+            {
+                if (skip(s, maneuver_mixes(params, N) * variants))
+                    continue;
+                for (int num_d30 = 0; num_d30 <= N; num_d30++)
+                {
+                    if (skip(s, variants))
+                        continue;
+                    int num_nk25 = N - num_d30;
+                    candidate c{ num_d30s, 0, num_d30, num_nk25, 0 };
+                    if (!do_search1<mode>(s, c))
+                        return;
+                }
+            }
+        }
+}
+
+// search_engines<mode>() for the query's mode
+template<unsigned... modes>
+HF_DESIGN_TARGET static void search_engines(search_state& s, std::integer_sequence<unsigned, modes...>)
+{
+    const unsigned mode = kernel_mode(s.params, s.control.explain);
+    ((mode == modes ? search_engines<modes>(s) : void()), ...);
+}
+
+// build_design() for 'mode', the tanks as its bit says
+template<unsigned... modes>
+HF_DESIGN_TARGET static bool build_design(unsigned mode, const ship& frame, ship& st, const cmdline& params,
+                                          const candidate& c, const generators& g, filter& filter_ship,
+                                          std::uint64_t seq, std::integer_sequence<unsigned, modes...>)
+{
+    bool ok = false;
+    ((mode == modes ? (void)(ok = build_design<modes & ~mode_missions, (modes & mode_big_tanks) != 0>(
+                                 frame, st, params, c, g, filter_ship, nullptr, seq, false))
+                    : void()), ...);
+    return ok;
+}
+
+HF_DESIGN_TARGET void do_search(const ship& st_, ship& st, const cmdline& params,
+                                const search_range& range, search_control& control)
+{
+    search_state s{st_, st, params, range, control};
+    if (params.mission.enabled || params.duel.enabled)
+        for (auto& b : s.missions)
+            b = std::make_unique<mission_batch>();
+    if (control.summary)
+        s.summary = std::make_unique<design_summary>(params);
+
+    search_engines(s, std::make_integer_sequence<unsigned, num_modes>{});
+    flush_missions(s);
+    control.searched.store(searched(s), std::memory_order_relaxed);
+    if (s.num_designs < params.num_matches && !control.stopped)
+        replay_spill(s);
+    else if (s.spill)
+        fclose(s.spill);
+    if (s.summary)
+        control.summary->merge(*s.summary);
+}
+
+// a candidate on its own, the way the walk builds it. false if it makes
+// no design or the filters turn it down.
+HF_DESIGN_TARGET bool build_candidate(const ship& base, ship& st, const cmdline& params, const candidate& c,
+                                      filter& filter_ship, filter& filter_mission, filter& filter_duel)
+{
+    thread_local ship frame;
+    if (!has_legs(params, c))
+        return false;
+    build_frame(base, frame, params, c, false);
+    thread_local std::vector<generators> power;
+    power.resize((std::size_t)power_steps(params));
+    plan_power(frame, params, power.data());
+    const generators& g = power[(std::size_t)c.power];
+    if (g.again) // the walk makes nothing of it
+        return false;
+    const unsigned mode = (kernel_mode(params, nullptr) & ~mode_big_tanks) | (c.big_tanks ? mode_big_tanks : 0);
+    if (!build_design(mode, frame, st, params, c, g, filter_ship, candidate_seq(params, c),
+                      std::make_integer_sequence<unsigned, mode_explain>{}))
+        return false;
+    if (params.mission.enabled)
+    {
+        thread_local std::unique_ptr<mission_batch> missions;
+        if (!missions)
+            missions = std::make_unique<mission_batch>();
+        auto& b = *missions;
+        b.ships[0] = st;
+        b.count = 1;
+        fly_mission(b, params.mission);
+        st.mission = b.ships[0].mission;
+    }
+    if (!filter_mission(st))
+        return false;
+    if (params.duel.enabled)
+    {
+        const int which = 0;
+        fight_duels(&st, &which, 1, params.duel.enemy(*params.catalog), params, nullptr);
+    }
+    return filter_duel(st);
+}
+
+} // namespace hf::design::HF_DESIGN_ISA
+
+#undef HF_DESIGN_ISA
+#undef HF_DESIGN_TARGET
@@ -0,0 +1,156 @@
+#include "search.hpp"
+#include "space.hpp"
+#include "atlas.hpp"
+#include "report.hpp"
+#include "checkpoint.hpp"
+#include "output.hpp"
+#include "sort.hpp"
+#include "fleet.hpp"
+#include "explain.hpp"
+#include "summary.hpp"
+#include "record.hpp"
+#include "trace.hpp"
+#include "part.hpp"
+#include "part-list.hpp"
+#include "ship.hpp"
+#include "cmdline.hpp"
+#include "filter.hpp"
+#include "layout.hpp"
+#include "mission.hpp"
+#include "duel.hpp"
+#include "duel-pool.hpp"
+#include "defs.hpp"
+#include "log.hpp"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <tuple>
+#include <utility>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+// the kernel is compiled once per instruction set. only functions defined
+// in search-kernel.hpp get the target attribute; everything it calls from
+// the headers above stays baseline, so no wider code can leak into the
+// generic path through shared inline or template instances.
+
+#define HF_DESIGN_ISA isa_generic
+#define HF_DESIGN_TARGET
+#include "search-kernel.hpp"
+
+#ifdef HF_DESIGN_DISPATCH
+#   define HF_DESIGN_ISA isa_avx2
+#   define HF_DESIGN_TARGET __attribute__((target("popcnt,avx2,fma,bmi,bmi2,lzcnt,movbe,f16c")))
+#   include "search-kernel.hpp"
+
+#   define HF_DESIGN_ISA isa_avx512
+#   define HF_DESIGN_TARGET __attribute__((target("popcnt,avx2,fma,bmi,bmi2,lzcnt,movbe,f16c," \
+                                                  "avx512f,avx512bw,avx512cd,avx512dq,avx512vl")))
+#   include "search-kernel.hpp"
+#endif
+
+namespace hf::design {
+
+const search_kernel& search_kernel::select()
+{
+    static const search_kernel kernel = [] {
+#ifdef HF_DESIGN_DISPATCH
+        __builtin_cpu_init();
+        bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+                    __builtin_cpu_supports("bmi2");
+        bool avx512 = avx2 &&
+                      __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+                      __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl");
+        if (avx512)
+            return search_kernel{ "avx512", isa_avx512::do_search, isa_avx512::build_candidate };
+        if (avx2)
+            return search_kernel{ "avx2", isa_avx2::do_search, isa_avx2::build_candidate };
+#endif
+        return search_kernel{ "generic", isa_generic::do_search, isa_generic::build_candidate };
+    }();
+    return kernel;
+}
+
+void search_candidates(const ship& base, const cmdline& params_,
+                       std::uint64_t begin, std::uint64_t end, search_control& control)
+{
+    if (atlas_search(base, params_, begin, std::min(end, search_space(params_) * (unsigned)search_passes(params_)),
+                     control))
+        return;
+
+    const auto& kernel = search_kernel::select();
+    cmdline params = params_;
+    const std::uint64_t space = search_space(params);
+    const int passes = search_passes(params);
+    ship st;
+
+    // big tanks and small tanks in one walk over the space, both built on
+    // the same engines and legs. the small-tank designs wait in a spill
+    // file until the big-tank ones are out. a checkpoint would have to
+    // keep the spill, so those searches still take two passes.
+    if (passes == 2 && !control.ckpt)
+    {
+        search_range r;
+        r.begin = std::min(begin, space);
+        r.end = std::min(end, space);
+        r.seq = 0;
+        r.small_begin = std::max(begin, space) - space;
+        r.small_end = std::max(std::min(end, 2 * space), space) - space;
+        r.small_seq = space;
+        trace_span t{"pass"};
+        kernel.do_search(base, st, params, r, control);
+        return;
+    }
+
+    // big tanks first, then the same space again without them
+    for (int pass = 0; pass < passes && !control.stopped; pass++)
+    {
+        const std::uint64_t first = space * (unsigned)pass;
+        if (pass > 0)
+            params.use_big_tanks = false;
+        if (end <= first || begin >= first + space)
+            continue;
+        search_range r;
+        r.begin = std::max(begin, first) - first;
+        r.end = std::min(end, first + space) - first;
+        r.seq = first;
+        trace_span t{"pass"};
+        kernel.do_search(base, st, params, r, control);
+    }
+}
+
+void report_design(search_control& control, const ship& st, const cmdline& params, design_summary* summary)
+{
+    if (!summary)
+        summary = control.summary;
+    if (control.quiet)
+        control.num_designs++;
+    else if (control.output)
+    {
+        control.output->push(st);
+        control.num_designs++;
+    }
+    else if (control.sorter)
+    {
+        control.sorter->push(st);
+        control.num_designs++;
+    }
+    else if (control.fleet)
+    {
+        control.fleet->push(st);
+        control.num_designs++;
+    }
+    else if (summary)
+    {
+        summary->push(st);
+        control.num_designs++;
+    }
+    else
+        design::report(st, control.num_designs, params) && control.num_designs++;
+}
+
+} // namespace hf::design
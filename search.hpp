@@ -0,0 +1,80 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace hf::design {
+
+struct ship;
+struct cmdline;
+struct search_range;
+struct checkpoint;
+struct output_pipe;
+struct design_sorter;
+struct fleet_pool;
+struct near_misses;
+struct design_summary;
+struct duel_pool;
+struct candidate;
+struct filter;
+
+// what the passes of a search share. 'searched' (candidates behind the
+// search, of all passes) and 'designs' are published every few thousand
+// candidates for others to watch.
+struct search_control final
+{
+    int num_designs = 0;
+    checkpoint* ckpt = nullptr; // saved to now and then when set
+    output_pipe* output = nullptr; // designs go there when set
+    design_sorter* sorter = nullptr; // or there
+    fleet_pool* fleet = nullptr; // or there
+    design_summary* summary = nullptr; // or into there
+    near_misses* explain = nullptr; // sees every design built when set
+    duel_pool* duels = nullptr; // fights the --duel duels of a batch when set
+    bool stopped = false;       // by a signal, the checkpoint is current
+    bool quiet = false;         // count designs, don't report them
+
+    std::atomic<std::uint64_t> searched{0};
+    std::atomic<int> designs{0};
+};
+
+using search_fn = void(*)(const ship& st_, ship& st, const cmdline& params,
+                           const search_range& range, search_control& control);
+
+using build_fn = bool(*)(const ship& base, ship& st, const cmdline& params, const candidate& c,
+                          filter& filter_ship, filter& filter_mission, filter& filter_duel);
+
+namespace isa_generic {
+void do_search(const ship&, ship&, const cmdline&, const search_range&, search_control&);
+bool build_candidate(const ship&, ship&, const cmdline&, const candidate&, filter&, filter&, filter&);
+}
+#ifdef HF_DESIGN_DISPATCH
+namespace isa_avx2 {
+void do_search(const ship&, ship&, const cmdline&, const search_range&, search_control&);
+bool build_candidate(const ship&, ship&, const cmdline&, const candidate&, filter&, filter&, filter&);
+}
+namespace isa_avx512 {
+void do_search(const ship&, ship&, const cmdline&, const search_range&, search_control&);
+bool build_candidate(const ship&, ship&, const cmdline&, const candidate&, filter&, filter&, filter&);
+}
+#endif
+
+struct search_kernel final
+{
+    const char* isa;
+    search_fn do_search;
+    build_fn build; // a single candidate
+
+    // picks the widest variant the running cpu supports, once.
+    static const search_kernel& select();
+};
+
+// a design into whichever of the control's sinks is set. the walk gives
+// each thread its own 'summary', merged into the control's at the end.
+void report_design(search_control& control, const ship& st, const cmdline& params,
+                   design_summary* summary = nullptr);
+
+// candidates [begin, end) of all passes, in order, see space.hpp
+void search_candidates(const ship& base, const cmdline& params,
+                       std::uint64_t begin, std::uint64_t end, search_control& control);
+
+} // namespace hf::design
@@ -2,58 +2,16 @@
 #include "part-list.hpp"
 #include "log.hpp"
 
-namespace hf::design {
+#include <cstdio>
+#include <cstring>
 
-int ship::count(const part& x) const
-{
-    return parts[x.index].second;
-}
+namespace hf::design {
 
-ship::ship()
+ship::ship(const part_catalog& catalog) : catalog{&catalog}
 {
     add_part_(bridge);
 }
 
-void ship::add_part_(const part& x, int count, area_mode amode)
-{
-    ASSERT(count >= 0);
-    if (amode && x.area() <= 0)
-        ABORT("add_part_() wrong area for part %s", x.name);
-
-    mass += x.mass * count;
-    power += x.power * count;
-    if (amode)
-        area += count * x.area();
-    cost += x.price * count;
-    if (x.fuel >= 0)
-        fuel += x.fuel * count;
-    else
-        fuel_flow -= x.fuel * count;
-    thrust += x.thrust * count;
-    if (x != e_d30s && x != e_rd51)
-        horizontal_thrust += x.thrust * count;
-
-    if (count)
-    {
-        //(void)find_part_or_die(x.name);
-        parts[x.index].second += count;
-
-        if (x == h_cor)
-            sneaky_corners_left += count;
-    }
-}
-
-void ship::add_part(const part& x, int count)
-{
-    ASSERT(count >= 0);
-    add_part_(x, count);
-    const auto& hull = part::find_hull(x);
-
-    ASSERT(hull != null_part);
-    if (hull != h_null)
-        add_part_(hull, count, area_disabled);
-}
-
 decltype(ship::parts) ship::init_parts()
 {
     const auto& all_parts = part::all_parts();
@@ -63,4 +21,39 @@ decltype(ship::parts) ship::init_parts()
     return parts;
 }
 
+bool add_gun(ship& st, const char* str)
+{
+    char buf[128 + 2] = { 'g', '_', '\0' };
+    if (strlen(str) >= sizeof(buf))
+        return false;
+    int count = 0;
+    int ret = sscanf(str, "%d:%127s", &count, buf+2);
+    buf[sizeof(buf)-1] = '\0';
+    if (ret != 2 || count <= 0)
+    {
+        ERR("wrong gun specification -- '%s'", str);
+        return false;
+    }
+
+    const auto& p = part::find_part(buf);
+    if (p == null_part)
+    {
+        ERR("no such gun -- '%s'", buf + 2);
+        return false;
+    }
+    const int per_gun = (*st.catalog)[p].ammo;
+    if (per_gun >= 0)
+    {
+        ERR("part not a gun -- '%s'", str);
+        return false;
+    }
+    st.add_part(p, count);
+    int ammo = -per_gun * count;
+    int ammo_big = ammo / 2, ammo_small = ammo % 2;
+    st.add_part(ammo_2x2, ammo_big);
+    st.add_part(ammo_1x2, ammo_small);
+
+    return true;
+}
+
 } // namespace hf::design
@@ -1,7 +1,14 @@
 #pragma once
 
 #include "part.hpp"
+#include "catalog.hpp"
+#include "part-list.hpp"
+#include "mission.hpp"
+#include "duel.hpp"
+#include "log.hpp"
+#include <algorithm>
 #include <vector>
+#include <cstdint>
 #include <utility>
 
 namespace hf::design {
@@ -15,6 +22,12 @@ struct ship final
     std::vector<std::pair<const part*, int>> parts = init_parts();
     float mass = 0, power = 0, fuel = 0, fuel_flow = 0, thrust = 0, horizontal_thrust = 0;
     int area = 0, cost = 0, sneaky_corners_left = 0;
+    int footprints[fp_count] = {};  // parts that take up room on the grid, by shape
+    short width = 0, height = 0, perimeter = 0; // set by the layout stage
+    mission_result mission;
+    duel_result duel;
+    std::uint64_t seq = 0; // place in the search order, see space.hpp
+    const part_catalog* catalog; // the values its parts are added up with
 
     constexpr float twr() const { return thrust * 1000 / (mass * 9.81f); }
     constexpr float horizontal_twr() const { return horizontal_thrust * 1000 / (mass * 9.81f); }
@@ -28,8 +41,72 @@ struct ship final
     void add_part_(const part& x, int count = 1, area_mode amode = area_enabled);
     static decltype(parts) init_parts();
 
-    ship();
+    ship() : ship{part_catalog::builtin()} {}
+    explicit ship(const part_catalog& catalog);
     ship& operator=(const ship&) = default;
 };
 
+// 'count:name' of a gun and its ammo. false once the error is printed.
+bool add_gun(ship& st, const char* str);
+
+// the search hangs one leg off a corner and the rest off each other when
+// the d30s come in pairs, at least four of them, and there's no rd51
+constexpr bool single_leg_mount(int d30s, int rd51) { return !rd51 && d30s % 2 == 0 && d30s >= 4; }
+
+// small tanks the search tucks into spare corners, two half-hulls each,
+// instead of giving them hulls of their own
+constexpr int sneaky_tanks(int corners, int tanks) { return std::min(corners / 2, tanks); }
+
+// accumulation is inline so that each search kernel variant compiles it
+// for its own instruction set.
+
+inline int ship::count(const part& x) const
+{
+    return parts[x.index].second;
+}
+
+inline void ship::add_part_(const part& x, int count, area_mode amode)
+{
+    ASSERT(count >= 0);
+    if (amode && x.area() <= 0)
+        ABORT("add_part_() wrong area for part %s", x.name);
+
+    const part_values& v = (*catalog)[x];
+    mass += v.mass * count;
+    power += v.power * count;
+    if (amode)
+    {
+        area += count * x.area();
+        footprints[x.shape()] += count;
+    }
+    cost += v.price * count;
+    if (v.fuel >= 0)
+        fuel += v.fuel * count;
+    else
+        fuel_flow -= v.fuel * count;
+    thrust += v.thrust * count;
+    if (x != e_d30s && x != e_rd51)
+        horizontal_thrust += v.thrust * count;
+
+    if (count)
+    {
+        //(void)find_part_or_die(x.name);
+        parts[x.index].second += count;
+
+        if (x == h_cor)
+            sneaky_corners_left += count;
+    }
+}
+
+inline void ship::add_part(const part& x, int count)
+{
+    ASSERT(count >= 0);
+    add_part_(x, count);
+    const auto& hull = catalog->hull_of(x);
+
+    ASSERT(hull != null_part);
+    if (hull != h_null)
+        add_part_(hull, count, area_disabled);
+}
+
 } // namespace hf::design
@@ -0,0 +1,72 @@
+#include "sort.hpp"
+#include "metric.hpp"
+#include "record.hpp"
+#include "report.hpp"
+#include "cmdline.hpp"
+#include "part.hpp"
+#include "ship.hpp"
+#include "trace.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace hf::design {
+
+namespace {
+
+// a key as a word that orders like it: nan last, then flipped so that
+// unsigned order is the double's
+std::uint64_t key_word(double x, bool descending)
+{
+    if (std::isnan(x))
+        x = HUGE_VAL;
+    else if (descending)
+        x = -x;
+    x += 0.0; // -0 ties with 0
+    std::uint64_t ret;
+    memcpy(&ret, &x, sizeof(ret));
+    return ret >> 63 ? ~ret : ret | std::uint64_t{1} << 63;
+}
+
+} // namespace
+
+// the keys, then the record, which starts with the sequence number for ties
+design_sorter::design_sorter(const cmdline& params) :
+    params{params},
+    num_keys{(std::size_t)params.sort.num_keys},
+    sorter{num_keys * sizeof(std::uint64_t) + record_size(part::all_parts().size()), num_keys + 1,
+           params.sort.memory, (std::uint64_t)params.num_matches},
+    parts{part::all_parts()}
+{
+}
+
+void design_sorter::push(const ship& st)
+{
+    unsigned char* p = sorter.push();
+    for (std::size_t i = 0; i < num_keys; i++)
+    {
+        const auto& key = params.sort.keys[i];
+        const std::uint64_t x = key_word(metric_value(st, key.m), key.descending);
+        memcpy(p, &x, sizeof(x));
+        p += sizeof(x);
+    }
+    pack_record(p, st);
+}
+
+int design_sorter::finish()
+{
+    sorter.finish();
+    ship st{*params.catalog};
+    int k = 0;
+    trace_span t{"report"};
+    while (const unsigned char* entry = sorter.next())
+    {
+        unpack_record(entry + num_keys * sizeof(std::uint64_t), st, parts);
+        report(st, k, params) && k++;
+    }
+    fflush(stdout);
+    return k;
+}
+
+} // namespace hf::design
@@ -0,0 +1,50 @@
+#pragma once
+#include "run-sort.hpp"
+#include <cstddef>
+#include <vector>
+
+namespace hf::design {
+
+enum class metric : unsigned char;
+struct ship;
+struct part;
+struct cmdline;
+
+// --sort: designs ordered by metrics, each ascending or descending, ties
+// in search order.
+struct sort_order final
+{
+    static constexpr int max_keys = 8;
+
+    struct key final
+    {
+        metric m;
+        bool descending;
+    };
+
+    key keys[max_keys] = {};
+    int num_keys = 0;
+    std::size_t memory = std::size_t{256} << 20; // bytes held before spilling a run
+
+    bool enabled() const { return num_keys > 0; }
+};
+
+// takes the designs of a --sort search, packed as records behind their
+// sort keys, and once they're all in streams them into the reporters in
+// order, up to -n of them. see run_sorter for what doesn't fit 'memory'.
+struct design_sorter final
+{
+    explicit design_sorter(const cmdline& params);
+
+    void push(const ship& st);
+    // returns the number of designs reported
+    int finish();
+
+private:
+    const cmdline& params;
+    const std::size_t num_keys;
+    run_sorter sorter;
+    std::vector<const part*> parts;
+};
+
+} // namespace hf::design
@@ -0,0 +1,229 @@
+#pragma once
+#include "cmdline.hpp"
+#include <cstdint>
+
+namespace hf::design {
+
+// the engine loops in search_engines() walk a fixed space of candidates,
+// every one of them built and filtered. these count it in closed form, so
+// a slice of the space can be searched without visiting what comes before.
+
+namespace space_detail {
+
+constexpr std::uint64_t tri(std::uint64_t n) { return n * (n + 1) / 2; }
+constexpr std::uint64_t tet(std::uint64_t n) { return n * (n + 1) * (n + 2) / 6; }
+
+} // namespace space_detail
+
+// maneuvering thruster mixes of N engines: d30 + nk25 (+ rd59 with -B)
+constexpr std::uint64_t maneuver_mixes(const cmdline& p, int N)
+{
+    const auto n = (std::uint64_t)N + 1;
+    return p.use_big_engines ? space_detail::tri(n) : n;
+}
+
+constexpr std::uint64_t maneuver_space(const cmdline& p)
+{
+    using namespace space_detail;
+    const int lo = p.engines.min, hi = p.engines.max;
+    if (hi < lo)
+        return 0;
+    return p.use_big_engines ? tet((std::uint64_t)hi + 1) - tet((std::uint64_t)lo)
+                             : tri((std::uint64_t)hi + 1) - tri((std::uint64_t)lo);
+}
+
+// fixed thruster mixes of F engines: d30s (+ rd51 with -B)
+constexpr std::uint64_t fixed_mixes(const cmdline& p, int F)
+{
+    return p.use_big_engines ? (std::uint64_t)F + 1 : 1;
+}
+
+// sets of engines in one pass
+constexpr std::uint64_t engine_space(const cmdline& p)
+{
+    using namespace space_detail;
+    const int lo = p.fixed_engines.min;
+    const int hi = p.use_big_engines ? p.engines.max : p.fixed_engines.max;
+    if (hi < lo)
+        return 0;
+    const std::uint64_t fixed = p.use_big_engines ? tri((std::uint64_t)hi + 1) - tri((std::uint64_t)lo)
+                                                  : (std::uint64_t)(hi - lo) + 1;
+    return fixed * maneuver_space(p);
+}
+
+// mixes of the leg counts -C gives ranges for, leg1 changing slowest
+constexpr std::uint64_t chassis_mixes(const cmdline& p)
+{
+    std::uint64_t n = 1;
+    if (p.chassis.enabled())
+        for (std::size_t i = 0; i < p.chassis.min.size(); i++)
+            n *= (std::uint64_t)(p.chassis.max[i] - p.chassis.min[i]) + 1;
+    return n;
+}
+
+constexpr int extinguisher_counts(const cmdline& p) { return p.extinguishers.max - p.extinguishers.min + 1; }
+
+// -P goes from its least to its most in steps of a percent
+constexpr int power_steps(const cmdline& p) { return (int)((p.power.max - p.power.min) * 100 + .5f) + 1; }
+
+constexpr float power_at(const cmdline& p, int step)
+{
+    const int n = power_steps(p);
+    return n == 1 ? p.power.max : p.power.min + (p.power.max - p.power.min) * (float)step / (float)(n - 1);
+}
+
+// what's tried on each set of engines: chassis mixes, in each of those
+// the extinguisher counts and in each of those the power steps.
+constexpr std::uint64_t variant_space(const cmdline& p)
+{
+    return chassis_mixes(p) * (unsigned)extinguisher_counts(p) * (unsigned)power_steps(p);
+}
+
+// candidates in one pass. -b searches the space twice, first with big
+// tanks, then without.
+constexpr std::uint64_t search_space(const cmdline& p)
+{
+    return engine_space(p) * variant_space(p);
+}
+
+constexpr int search_passes(const cmdline& p) { return p.use_big_tanks ? 2 : 1; }
+
+// one candidate as search_engines() builds it: d30s and rd51 fixed
+// thrusters, d30, nk25 and rd59 maneuvering ones, and with -b whether it
+// takes big tanks. then the legs (all 0 without -C), the extinguishers
+// and the power step, see power_at().
+struct candidate final
+{
+    int d30s = 0, rd51 = 0, d30 = 0, nk25 = 0, rd59 = 0;
+    bool big_tanks = false;
+    int legs[4] = {};
+    int fire = 0, power = 0;
+};
+
+// the legs of chassis mix 'i'
+constexpr void chassis_mix(const cmdline& p, std::uint64_t i, candidate& c)
+{
+    for (std::size_t k = p.chassis.min.size(); k-- > 0; )
+    {
+        const auto n = (std::uint64_t)(p.chassis.max[k] - p.chassis.min[k]) + 1;
+        c.legs[k] = p.chassis.min[k] + (int)(i % n);
+        i /= n;
+    }
+}
+
+// where among variant_space() the candidate's variant is
+constexpr std::uint64_t variant_index(const cmdline& p, const candidate& c)
+{
+    std::uint64_t mix = 0;
+    for (std::size_t k = 0; k < p.chassis.min.size(); k++)
+        mix = mix * ((std::uint64_t)(p.chassis.max[k] - p.chassis.min[k]) + 1) +
+              (std::uint64_t)(c.legs[k] - p.chassis.min[k]);
+    return (mix * (unsigned)extinguisher_counts(p) + (unsigned)(c.fire - p.extinguishers.min)) *
+           (unsigned)power_steps(p) + (unsigned)c.power;
+}
+
+constexpr bool in_space(const cmdline& p, const candidate& c)
+{
+    const int F = c.d30s + c.rd51, N = c.d30 + c.nk25 + c.rd59;
+    if (c.d30s < 0 || c.rd51 < 0 || c.d30 < 0 || c.nk25 < 0 || c.rd59 < 0)
+        return false;
+    if (N < p.engines.min || N > p.engines.max || (c.big_tanks && !p.use_big_tanks))
+        return false;
+    if (!p.extinguishers.check(c.fire) || c.power < 0 || c.power >= power_steps(p))
+        return false;
+    for (std::size_t k = 0; k < p.chassis.min.size(); k++)
+        if (p.chassis.enabled() ? c.legs[k] < p.chassis.min[k] || c.legs[k] > p.chassis.max[k] : c.legs[k] != 0)
+            return false;
+    if (p.use_big_engines)
+        return F >= p.fixed_engines.min && F <= p.engines.max;
+    return !c.rd51 && !c.rd59 && F >= p.fixed_engines.min && F <= p.fixed_engines.max;
+}
+
+// where the walk comes across it, numbered across passes like designs' seq
+constexpr std::uint64_t candidate_seq(const cmdline& p, const candidate& c)
+{
+    using namespace space_detail;
+    const auto N = (std::uint64_t)(c.d30 + c.nk25 + c.rd59), d30 = (std::uint64_t)c.d30;
+    const auto lo = (std::uint64_t)p.engines.min;
+    std::uint64_t idx = 0;
+    if (p.use_big_engines)
+    {
+        const auto F = (std::uint64_t)(c.d30s + c.rd51);
+        idx = (tri(F) - tri((std::uint64_t)p.fixed_engines.min) + (std::uint64_t)c.d30s) * maneuver_space(p) +
+              tet(N) - tet(lo) + d30 * (2 * N + 3 - d30) / 2 + (std::uint64_t)c.nk25;
+    }
+    else
+        idx = (std::uint64_t)(c.d30s - p.fixed_engines.min) * maneuver_space(p) + tri(N) - tri(lo) + d30;
+    idx = idx * variant_space(p) + variant_index(p, c);
+    return c.big_tanks || !p.use_big_tanks ? idx : search_space(p) + idx;
+}
+
+// the candidate numbered 'seq', candidate_seq() the other way round
+constexpr candidate candidate_at(const cmdline& p, std::uint64_t seq)
+{
+    using namespace space_detail;
+    candidate c;
+    const std::uint64_t space = search_space(p);
+    c.big_tanks = p.use_big_tanks && seq < space;
+    std::uint64_t idx = seq % space, v = idx % variant_space(p);
+    idx /= variant_space(p);
+
+    c.power = (int)(v % (unsigned)power_steps(p));
+    v /= (unsigned)power_steps(p);
+    c.fire = p.extinguishers.min + (int)(v % (unsigned)extinguisher_counts(p));
+    v /= (unsigned)extinguisher_counts(p);
+    if (p.chassis.enabled())
+        chassis_mix(p, v, c);
+
+    const auto lo = (std::uint64_t)p.engines.min;
+    std::uint64_t m = idx % maneuver_space(p), f = idx / maneuver_space(p), N = lo;
+    if (p.use_big_engines)
+    {
+        auto F = (std::uint64_t)p.fixed_engines.min;
+        while (tri(F + 1) - tri((std::uint64_t)p.fixed_engines.min) <= f)
+            F++;
+        c.d30s = (int)(f - (tri(F) - tri((std::uint64_t)p.fixed_engines.min)));
+        c.rd51 = (int)F - c.d30s;
+        while (tet(N + 1) - tet(lo) <= m)
+            N++;
+        m -= tet(N) - tet(lo);
+        std::uint64_t d30 = 0;
+        while ((d30 + 1) * (2 * N + 3 - (d30 + 1)) / 2 <= m)
+            d30++;
+        c.d30 = (int)d30;
+        c.nk25 = (int)(m - d30 * (2 * N + 3 - d30) / 2);
+        c.rd59 = (int)N - c.d30 - c.nk25;
+    }
+    else
+    {
+        c.d30s = p.fixed_engines.min + (int)f;
+        while (tri(N + 1) - tri(lo) <= m)
+            N++;
+        c.d30 = (int)(m - (tri(N) - tri(lo)));
+        c.nk25 = (int)N - c.d30;
+    }
+    return c;
+}
+
+// slice [begin, end) of the candidates of one pass. 'seq' numbers the
+// first candidate of the pass, counting across passes, so that designs
+// can be put back in order when shards are merged. with -b the small-tank
+// pass can come along in the same walk, its slice is [small_begin,
+// small_end), numbered from 'small_seq'.
+struct search_range final
+{
+    std::uint64_t begin = 0, end = UINT64_MAX;
+    std::uint64_t seq = 0;
+    std::uint64_t small_begin = 0, small_end = 0, small_seq = 0;
+};
+
+// shard i of n gets an equal share of all passes' candidates, the first
+// total % n shards one more.
+constexpr search_range shard_range(std::uint64_t total, int i, int n)
+{
+    const std::uint64_t q = total / (unsigned)n, r = total % (unsigned)n;
+    const auto at = [&](std::uint64_t k) { return k * q + (k < r ? k : r); };
+    return { at((unsigned)i), at((unsigned)i + 1) };
+}
+
+} // namespace hf::design
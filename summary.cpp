@@ -0,0 +1,270 @@
+#include "summary.hpp"
+#include "cmdline.hpp"
+#include "metric.hpp"
+#include "part-list.hpp"
+#include "ship.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <tuple>
+
+namespace hf::design {
+
+namespace {
+
+constexpr int shift = 52 - quantile_sketch::mantissa_bits;
+constexpr double tiny = 1e-9; // counted as 0
+
+const std::tuple<const char*, const part&> engine_parts[] = {
+    { "d30s",   e_d30s  },
+    { "d30",    e_d30   },
+    { "nk25",   e_nk25  },
+    { "rd51",   e_rd51  },
+    { "rd59",   e_rd59  },
+};
+
+constexpr double quantiles[] = { .1, .5, .9 };
+
+} // namespace
+
+int quantile_sketch::index_of(double x)
+{
+    std::uint64_t bits;
+    memcpy(&bits, &x, sizeof(x));
+    return (int)(bits >> shift);
+}
+
+// the middle of the bucket
+double quantile_sketch::value_of(int i)
+{
+    const std::uint64_t bits = (std::uint64_t)i << shift | std::uint64_t{1} << (shift - 1);
+    double x;
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+void quantile_sketch::buckets::add(int i, std::uint64_t n)
+{
+    if (counts.empty())
+        first = i;
+    if (i < first)
+    {
+        counts.insert(counts.begin(), (std::size_t)(first - i), 0);
+        first = i;
+    }
+    if ((std::size_t)(i - first) >= counts.size())
+        counts.resize((std::size_t)(i - first) + 1);
+    counts[(std::size_t)(i - first)] += n;
+}
+
+void quantile_sketch::push(double x)
+{
+    count++;
+    if (x > tiny)
+        pos.add(index_of(x), 1);
+    else if (x < -tiny)
+        neg.add(index_of(-x), 1);
+    else
+        zeros++;
+}
+
+void quantile_sketch::merge(const quantile_sketch& x)
+{
+    count += x.count;
+    zeros += x.zeros;
+    for (std::size_t i = 0; i < x.pos.counts.size(); i++)
+        if (x.pos.counts[i])
+            pos.add(x.pos.first + (int)i, x.pos.counts[i]);
+    for (std::size_t i = 0; i < x.neg.counts.size(); i++)
+        if (x.neg.counts[i])
+            neg.add(x.neg.first + (int)i, x.neg.counts[i]);
+}
+
+// the value of rank q * (count - 1), the way each() counts them
+double quantile_sketch::quantile(double q) const
+{
+    const auto rank = (std::uint64_t)(q * (double)(count - 1));
+    std::uint64_t seen = 0;
+    double ret = 0;
+    bool found = false;
+    each([&](double value, std::uint64_t n) {
+        if (!found && (seen += n) > rank)
+        {
+            ret = value;
+            found = true;
+        }
+    });
+    return ret;
+}
+
+design_summary::design_summary(const cmdline& params)
+{
+    const std::tuple<metric, bool> wanted[] = {
+        { metric::cost,             true    },
+        { metric::mass,             true    },
+        { metric::twr,              true    },
+        { metric::horizontal_twr,   false   },
+        { metric::combat_time,      true    },
+        { metric::speed,            false   },
+        { metric::fuel_usage,       false   },
+        { metric::range,            false   },
+    };
+    const auto add = [this](metric m, bool histogram) {
+        ASSERT(num_metrics < max_metrics);
+        metrics[num_metrics++] = { m, histogram, HUGE_VAL, -HUGE_VAL };
+    };
+    for (const auto& [m, histogram] : wanted)
+        add(m, histogram);
+    if (params.use_layout)
+        for (metric m : { metric::width, metric::height })
+            add(m, false);
+    if (params.mission.enabled)
+        for (metric m : { metric::mission_fuel, metric::mission_time, metric::mission_range })
+            add(m, false);
+    if (params.duel.enabled)
+        add(metric::win_rate, true);
+}
+
+void design_summary::push(const ship& st)
+{
+    count++;
+    for (int i = 0; i < num_metrics; i++)
+    {
+        auto& x = metrics[i];
+        const double value = metric_value(st, x.m);
+        if (std::isnan(value))
+            continue;
+        x.min = std::min(x.min, value);
+        x.max = std::max(x.max, value);
+        x.sum += value;
+        x.sketch.push(value);
+    }
+    for (int i = 0; i < num_engines; i++)
+        engines[i][std::min(st.count(std::get<1>(engine_parts[i])), max_engines)]++;
+}
+
+void design_summary::merge(const design_summary& x)
+{
+    ASSERT(num_metrics == x.num_metrics);
+    count += x.count;
+    for (int i = 0; i < num_metrics; i++)
+    {
+        auto& a = metrics[i];
+        const auto& b = x.metrics[i];
+        a.min = std::min(a.min, b.min);
+        a.max = std::max(a.max, b.max);
+        a.sum += b.sum;
+        a.sketch.merge(b.sketch);
+    }
+    for (int i = 0; i < num_engines; i++)
+        for (int k = 0; k <= max_engines; k++)
+            engines[i][k] += x.engines[i][k];
+}
+
+// the sketch's buckets put in bins from min to max, so the edges are as
+// good as its accuracy
+void design_summary::histogram(const stats& x, std::uint64_t* bins) const
+{
+    std::fill(bins, bins + num_bins, 0);
+    const double width = (x.max - x.min) / num_bins;
+    x.sketch.each([&](double value, std::uint64_t n) {
+        const double at = width > 0 ? (std::clamp(value, x.min, x.max) - x.min) / width : 0;
+        bins[std::min((int)at, num_bins - 1)] += n;
+    });
+}
+
+void design_summary::print(const cmdline& params) const
+{
+    if (params.format == cmdline::fmt_csv)
+        print_csv();
+    else
+        print_pretty();
+    fflush(stdout);
+}
+
+void design_summary::print_pretty() const
+{
+    constexpr int bar_width = 40;
+
+    printf("summary: %llu designs\n\n", (unsigned long long)count);
+    printf("  %-14s %10s %10s %10s %10s %10s %10s\n", "", "min", "p10", "p50", "p90", "max", "mean");
+    for (int i = 0; i < num_metrics; i++)
+    {
+        const auto& x = metrics[i];
+        if (!x.sketch.count)
+            continue;
+        printf("  %-14s %10.4g", metric_info_of(x.m).name, x.min);
+        for (double q : quantiles)
+            printf(" %10.4g", std::clamp(x.sketch.quantile(q), x.min, x.max));
+        printf(" %10.4g %10.4g\n", x.max, x.sum / (double)x.sketch.count);
+    }
+
+    std::uint64_t bins[num_bins];
+    for (int i = 0; i < num_metrics; i++)
+    {
+        const auto& x = metrics[i];
+        if (!x.histogram || !x.sketch.count)
+            continue;
+        histogram(x, bins);
+        const std::uint64_t most = *std::max_element(bins, bins + num_bins);
+        const double width = (x.max - x.min) / num_bins;
+        printf("\n  %s\n", metric_info_of(x.m).name);
+        for (int k = 0; k < (width > 0 ? num_bins : 1); k++)
+        {
+            const int bar = most ? (int)((double)bins[k] * bar_width / (double)most + .5) : 0;
+            printf("  %10.4g .. %-10.4g %-*.*s %llu\n", x.min + k * width, x.min + (k + 1) * width,
+                   bar_width, bar, "########################################", (unsigned long long)bins[k]);
+        }
+    }
+
+    printf("\n  engines, count:designs\n");
+    for (int i = 0; i < num_engines; i++)
+    {
+        printf("  %-6s", std::get<0>(engine_parts[i]));
+        for (int k = 0; k <= max_engines; k++)
+            if (engines[i][k])
+                printf(" %d%s:%llu", k, k == max_engines ? "+" : "", (unsigned long long)engines[i][k]);
+        printf("\n");
+    }
+}
+
+// three tables, one after the other
+void design_summary::print_csv() const
+{
+    printf("Metric,Designs,Min,P10,P50,P90,Max,Mean\n");
+    for (int i = 0; i < num_metrics; i++)
+    {
+        const auto& x = metrics[i];
+        if (!x.sketch.count)
+            continue;
+        printf("%s,%llu,%g", metric_info_of(x.m).name, (unsigned long long)x.sketch.count, x.min);
+        for (double q : quantiles)
+            printf(",%g", std::clamp(x.sketch.quantile(q), x.min, x.max));
+        printf(",%g,%g\n", x.max, x.sum / (double)x.sketch.count);
+    }
+
+    printf("\nHistogram,From,To,Designs\n");
+    std::uint64_t bins[num_bins];
+    for (int i = 0; i < num_metrics; i++)
+    {
+        const auto& x = metrics[i];
+        if (!x.histogram || !x.sketch.count)
+            continue;
+        histogram(x, bins);
+        const double width = (x.max - x.min) / num_bins;
+        for (int k = 0; k < (width > 0 ? num_bins : 1); k++)
+            printf("%s,%g,%g,%llu\n", metric_info_of(x.m).name, x.min + k * width, x.min + (k + 1) * width,
+                   (unsigned long long)bins[k]);
+    }
+
+    printf("\nEngine,Count,Designs\n");
+    for (int i = 0; i < num_engines; i++)
+        for (int k = 0; k <= max_engines; k++)
+            if (engines[i][k])
+                printf("%s,%d,%llu\n", std::get<0>(engine_parts[i]), k, (unsigned long long)engines[i][k]);
+}
+
+} // namespace hf::design
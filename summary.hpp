@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace hf::design {
+
+enum class metric : unsigned char;
+struct ship;
+struct cmdline;
+
+// counts of values in buckets by the exponent and the top 'mantissa_bits'
+// of the double, so a bucket is 1/64 of a power of two wide and any
+// quantile comes out within 2^-7 of the value it stands for. there's no
+// need to know the range beforehand, and adding up the buckets of two
+// sketches makes the sketch of both.
+struct quantile_sketch final
+{
+    static constexpr int mantissa_bits = 6;
+
+    void push(double x);
+    void merge(const quantile_sketch& x);
+    double quantile(double q) const;
+    // buckets by the value they stand for, negative ones first
+    template<typename fn> void each(fn&& f) const;
+
+    std::uint64_t count = 0;
+
+private:
+    struct buckets final
+    {
+        int first = 0; // index of counts[0]
+        std::vector<std::uint64_t> counts;
+
+        void add(int i, std::uint64_t n);
+    };
+
+    static int index_of(double x); // x > 0
+    static double value_of(int i);
+
+    buckets pos, neg; // neg of -x
+    std::uint64_t zeros = 0;
+};
+
+template<typename fn> void quantile_sketch::each(fn&& f) const
+{
+    for (std::size_t i = neg.counts.size(); i-- > 0; )
+        if (neg.counts[i])
+            f(-value_of(neg.first + (int)i), neg.counts[i]);
+    if (zeros)
+        f(0., zeros);
+    for (std::size_t i = 0; i < pos.counts.size(); i++)
+        if (pos.counts[i])
+            f(value_of(pos.first + (int)i), pos.counts[i]);
+}
+
+// --summary: what the designs of a search look like, taken in as they're
+// found and never kept. the range, mean and quantiles of the metrics, a
+// histogram of a few and how many of each engine the designs take. a
+// search adds up its own and merges it into the query's at the end.
+struct design_summary final
+{
+    static constexpr int max_metrics = 16;
+    static constexpr int num_bins = 10;   // histogram bins, min to max
+    static constexpr int num_engines = 5;
+    static constexpr int max_engines = 64; // counted one by one, more as 64
+
+    explicit design_summary(const cmdline& params);
+
+    void push(const ship& st);
+    void merge(const design_summary& x);
+    // -F csv or pretty
+    void print(const cmdline& params) const;
+
+private:
+    struct stats final
+    {
+        metric m;
+        bool histogram;
+        double min, max, sum = 0;
+        quantile_sketch sketch;
+    };
+
+    void print_pretty() const;
+    void print_csv() const;
+    void histogram(const stats& x, std::uint64_t* bins) const;
+
+    stats metrics[max_metrics];
+    int num_metrics = 0;
+    std::uint64_t count = 0;
+    std::uint64_t engines[num_engines][max_engines + 1] = {}; // designs by count
+};
+
+} // namespace hf::design
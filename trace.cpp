@@ -0,0 +1,281 @@
+#include "trace.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#   include <linux/perf_event.h>
+#   include <sys/syscall.h>
+#   include <unistd.h>
+#endif
+
+namespace hf::design {
+
+namespace {
+
+struct event final
+{
+    const char* name;
+    trace::clock::time_point begin, end;
+};
+
+// what the spans of a stage took, added up
+struct stage final
+{
+    const char* name;
+    std::uint64_t spans = 0;
+    trace::counters sum = {};
+};
+
+struct thread_log final
+{
+    int tid;
+    const char* name = nullptr;
+    std::vector<event> events;
+    // counters, all in one group so they're read at once
+    bool opened = false;
+    int fds[trace::num_counters];
+    int num_fds = 0;
+    trace::counter slots[trace::num_counters]; // of the values read
+    std::vector<stage> stages;
+};
+
+constexpr const char* counter_names[] = { "cycles", "instructions", "branch misses", "cache misses" };
+
+trace::clock::time_point origin;
+bool logging = false; // --trace
+std::atomic<bool> warned{false};
+std::mutex logs_lock;
+std::vector<std::unique_ptr<thread_log>> logs;
+thread_local thread_log* this_log = nullptr;
+
+thread_log& log_of_this_thread()
+{
+    if (!this_log)
+    {
+        std::lock_guard<std::mutex> l{logs_lock};
+        auto& x = *logs.emplace_back(std::make_unique<thread_log>());
+        x.tid = (int)logs.size();
+        x.events.reserve(4096);
+        this_log = &x;
+    }
+    return *this_log;
+}
+
+double usecs(trace::clock::duration d)
+{
+    return std::chrono::duration<double, std::micro>(d).count();
+}
+
+int open_counter(trace::counter x, int group)
+{
+#ifdef __linux__
+    constexpr std::uint64_t configs[] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES,
+    };
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = configs[x];
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group, PERF_FLAG_FD_CLOEXEC);
+#else
+    (void)x; (void)group;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+// on the thread's first span. what can't be had is warned about once.
+void open_counters(thread_log& x)
+{
+    x.opened = true;
+    std::string missing;
+    int error = 0;
+    for (unsigned i = 0; i < trace::num_counters; i++)
+    {
+        const auto which = (trace::counter)i;
+        const int fd = open_counter(which, x.num_fds ? x.fds[0] : -1);
+        if (fd >= 0)
+        {
+            x.slots[x.num_fds] = which;
+            x.fds[x.num_fds++] = fd;
+            continue;
+        }
+        error = errno;
+        missing += missing.empty() ? "" : ", ";
+        missing += counter_names[i];
+    }
+    if (!missing.empty() && !warned.exchange(true))
+        WARN("--perf-counters: can't count %s: %s", missing.c_str(), strerror(error));
+}
+
+const char* thread_name(const thread_log& x, char (&buf)[16])
+{
+    if (x.name)
+        return x.name;
+    snprintf(buf, sizeof(buf), "thread %d", x.tid);
+    return buf;
+}
+
+} // namespace
+
+bool trace::enabled = false;
+bool trace::counting = false;
+
+void trace::record(const char* name, clock::time_point begin, clock::time_point end)
+{
+    if (logging)
+        log_of_this_thread().events.push_back({ name, begin, end });
+}
+
+// zeros for the counters this thread doesn't have
+void trace::read(counters& x)
+{
+    auto& log = log_of_this_thread();
+    if (!log.opened)
+        open_counters(log);
+    std::fill(std::begin(x), std::end(x), 0);
+#ifdef __linux__
+    std::uint64_t buf[1 + num_counters]; // PERF_FORMAT_GROUP: how many, then the values
+    if (!log.num_fds || ::read(log.fds[0], buf, sizeof(buf)) < (ssize_t)sizeof(*buf))
+        return;
+    for (std::uint64_t i = 0; i < buf[0] && i < (std::uint64_t)log.num_fds; i++)
+        x[log.slots[i]] = buf[1 + i];
+#endif
+}
+
+void trace::count(const char* name, const counters& begin)
+{
+    counters end;
+    read(end);
+    auto& stages = log_of_this_thread().stages;
+    auto it = std::find_if(stages.begin(), stages.end(), [&](const stage& x) { return !strcmp(x.name, name); });
+    if (it == stages.end())
+    {
+        stages.push_back({ name });
+        it = stages.end() - 1;
+    }
+    it->spans++;
+    for (unsigned i = 0; i < num_counters; i++)
+        it->sum[i] += end[i] - begin[i];
+}
+
+void trace::name_thread(const char* name)
+{
+    if (enabled)
+        log_of_this_thread().name = name;
+}
+
+trace_session::trace_session(const char* path, trace::clock::time_point t0) : path{path}
+{
+    if (!path)
+        return;
+    origin = t0;
+    logging = true;
+    trace::enabled = true;
+    trace::name_thread("main");
+}
+
+// the other threads have been joined by now
+trace_session::~trace_session()
+{
+    if (!path)
+        return;
+    trace::enabled = false;
+    logging = false;
+
+    FILE* f = fopen(path, "w");
+    if (!f)
+    {
+        ERR("%s: %s", path, strerror(errno));
+        return;
+    }
+    std::lock_guard<std::mutex> l{logs_lock};
+    const char* sep = "";
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (const auto& x : logs)
+    {
+        if (x->name)
+        {
+            fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                    sep, x->tid, x->name);
+            sep = ",\n";
+        }
+        for (const auto& e : x->events)
+        {
+            fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    sep, e.name, x->tid, usecs(e.begin - origin), usecs(e.end - e.begin));
+            sep = ",\n";
+        }
+    }
+    fprintf(f, "\n]}\n");
+    if (fclose(f))
+        ERR("%s: %s", path, strerror(errno));
+}
+
+perf_session::perf_session(bool on) : on{on}, was_enabled{trace::enabled}
+{
+    if (!on)
+        return;
+    trace::enabled = true;
+    trace::counting = true;
+    trace::name_thread("main");
+}
+
+// per span of each stage, the other threads have been joined by now
+perf_session::~perf_session()
+{
+    if (!on)
+        return;
+    trace::counting = false;
+    trace::enabled = was_enabled;
+
+    std::lock_guard<std::mutex> l{logs_lock};
+    fprintf(stderr, "perf counters, user space, per span:\n");
+    fprintf(stderr, "  %-10s %-10s %10s %12s %12s %6s %10s %10s\n",
+            "thread", "stage", "spans", "cycles", "instructions", "ipc", "br-misses", "$-misses");
+    for (const auto& x : logs)
+    {
+        char buf[16];
+        bool has[trace::num_counters] = {};
+        for (int i = 0; i < x->num_fds; i++)
+            has[x->slots[i]] = true;
+        for (const auto& s : x->stages)
+        {
+            const auto per_span = [&](trace::counter k, char (&out)[16]) {
+                if (has[k])
+                    snprintf(out, sizeof(out), "%.0f", (double)s.sum[k] / (double)s.spans);
+                else
+                    snprintf(out, sizeof(out), "-");
+                return out;
+            };
+            char cyc[16], ins[16], br[16], cache[16], ipc[16] = "-";
+            if (has[trace::cycles] && has[trace::instructions] && s.sum[trace::cycles])
+                snprintf(ipc, sizeof(ipc), "%.2f", (double)s.sum[trace::instructions] / (double)s.sum[trace::cycles]);
+            fprintf(stderr, "  %-10s %-10s %10llu %12s %12s %6s %10s %10s\n", thread_name(*x, buf), s.name,
+                    (unsigned long long)s.spans, per_span(trace::cycles, cyc), per_span(trace::instructions, ins),
+                    ipc, per_span(trace::branch_misses, br), per_span(trace::cache_misses, cache));
+        }
+#ifdef __linux__
+        for (int i = 0; i < x->num_fds; i++)
+            close(x->fds[i]);
+#endif
+        x->num_fds = 0;
+        x->opened = false;
+    }
+}
+
+} // namespace hf::design
@@ -0,0 +1,92 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+namespace hf::design {
+
+// --trace: spans of what each thread did, written as chrome trace events
+// (chrome://tracing, perfetto) when the program ends. every thread logs
+// into a buffer of its own; with tracing off a span is one test of a
+// flag that never changes.
+//
+// --perf-counters: the same spans also read the thread's hardware
+// counters (perf_event_open, user space only) and add up what each stage
+// took, per thread, printed to stderr at the end. threads that can't open
+// them, as under most containers and VMs, count nothing.
+struct trace final
+{
+    using clock = std::chrono::steady_clock;
+
+    enum counter : unsigned char { cycles, instructions, branch_misses, cache_misses, num_counters };
+    using counters = std::uint64_t[num_counters];
+
+    static constexpr unsigned sample_mask = 1023; // per-candidate stages, 1 in 1024
+
+    static bool enabled;  // spans are taken. set before any thread starts, read-only after
+    static bool counting; // and read the counters
+
+    static void record(const char* name, clock::time_point begin, clock::time_point end);
+    static void read(counters& x);
+    static void count(const char* name, const counters& begin);
+    static void name_thread(const char* name);
+};
+
+// starts tracing to 'path' unless it's null, writes the file at the end
+// of its scope. 't0' is when the program started.
+struct trace_session final
+{
+    trace_session(const char* path, trace::clock::time_point t0);
+    ~trace_session();
+
+    trace_session(const trace_session&) = delete;
+    trace_session& operator=(const trace_session&) = delete;
+
+private:
+    const char* path;
+};
+
+// counts the spans of the threads while in scope if 'on', prints them at
+// the end of it
+struct perf_session final
+{
+    explicit perf_session(bool on);
+    ~perf_session();
+
+    perf_session(const perf_session&) = delete;
+    perf_session& operator=(const perf_session&) = delete;
+
+private:
+    bool on, was_enabled;
+};
+
+// 'name' must be a string literal, it's kept until the end
+struct trace_span final
+{
+    explicit trace_span(const char* name, bool on = trace::enabled) :
+        name{on ? name : nullptr}
+    {
+        if (!this->name)
+            return;
+        begin = trace::clock::now();
+        if (trace::counting)
+            trace::read(counts);
+    }
+    ~trace_span()
+    {
+        if (!name)
+            return;
+        if (trace::counting)
+            trace::count(name, counts);
+        trace::record(name, begin, trace::clock::now());
+    }
+
+    trace_span(const trace_span&) = delete;
+    trace_span& operator=(const trace_span&) = delete;
+
+private:
+    const char* name;
+    trace::clock::time_point begin;
+    trace::counters counts;
+};
+
+} // namespace hf::design